@@ -24,6 +24,12 @@ MODULES = {
 	"yaz0": ["src/module_yaz0.cpp"],
 	"audio": [
 		"src/module_audio.cpp",
+		"src/type_adpcm_decoder.cpp",
+		"src/type_stream_reader.cpp",
+		"src/type_ima_adpcm_decoder.cpp",
+		"src/type_ima_adpcm_encoder.cpp",
+		"src/type_resampler.cpp",
+		*walk("src/audio"),
 		*walk("src/dsptool")
 	]
 }
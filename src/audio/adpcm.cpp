@@ -0,0 +1,268 @@
+
+#include "audio/adpcm.h"
+#include "audio/interleave.h"
+#include "audio/sample.h"
+#include "dsptool/encoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audio {
+
+/* (nybble * scale) << 11 for every scale exponent and nybble */
+struct ADPCMScaleTable {
+	int32_t values[16][16];
+	
+	ADPCMScaleTable() {
+		for (int scale = 0; scale < 16; scale++) {
+			for (int nybble = 0; nybble < 16; nybble++) {
+				int value = nybble >= 8 ? nybble - 16 : nybble;
+				values[scale][nybble] = value * (1 << scale) * 2048;
+			}
+		}
+	}
+};
+
+static const ADPCMScaleTable adpcm_scale_table;
+
+
+int16_t clamp(int val) {
+	return std::min(std::max(val, -32768), 32767);
+}
+
+struct ADPCMFrameState {
+	const int32_t *scales;
+	int coef1;
+	int coef2;
+	int hist1;
+	int hist2;
+};
+
+static inline int16_t decode_adpcm_sample(ADPCMFrameState *state, int nybble) {
+	int hist = state->coef1 * state->hist1 + state->coef2 * state->hist2;
+	int16_t sample = clamp((state->scales[nybble] + hist + 1024) >> 11);
+	state->hist2 = state->hist1;
+	state->hist1 = sample;
+	return sample;
+}
+
+template <class T>
+static inline void decode_adpcm_full_frame(T *out, const uint8_t *in, ADPCMFrameState *state) {
+	for (int i = 0; i < 7; i++) {
+		store_sample(&out[i * 2], decode_adpcm_sample(state, in[i] >> 4));
+		store_sample(&out[i * 2 + 1], decode_adpcm_sample(state, in[i] & 0xF));
+	}
+}
+
+template <class T>
+static inline void decode_adpcm_partial_frame(T *out, const uint8_t *in, uint32_t count, ADPCMFrameState *state) {
+	for (uint32_t i = 0; i < count / 2; i++) {
+		store_sample(&out[i * 2], decode_adpcm_sample(state, in[i] >> 4));
+		store_sample(&out[i * 2 + 1], decode_adpcm_sample(state, in[i] & 0xF));
+	}
+	if (count % 2) {
+		store_sample(&out[count - 1], decode_adpcm_sample(state, in[count / 2] >> 4));
+	}
+}
+
+template <class T>
+static bool decode_adpcm_tmpl(
+	T *out, const uint8_t *in, uint32_t numSamples, ADPCMContext *ctx
+) {
+	ADPCMFrameState state;
+	state.hist1 = ctx->hist1;
+	state.hist2 = ctx->hist2;
+	
+	/* Samples are still decoded when out is NULL, because every sample depends on the previous ones */
+	T scratch[14];
+	
+	while (numSamples) {
+		ctx->header = *in++;
+		int coefIdx = ctx->header >> 4;
+		if (coefIdx >= 8) {
+			return false;
+		}
+		
+		state.scales = adpcm_scale_table.values[ctx->header & 0xF];
+		state.coef1 = ctx->coefs[coefIdx * 2];
+		state.coef2 = ctx->coefs[coefIdx * 2 + 1];
+		
+		T *dest = out ? out : scratch;
+		if (numSamples >= 14) {
+			decode_adpcm_full_frame(dest, in, &state);
+			in += 7;
+			numSamples -= 14;
+			if (out) out += 14;
+		}
+		else {
+			decode_adpcm_partial_frame(dest, in, numSamples, &state);
+			numSamples = 0;
+		}
+		
+		ctx->hist1 = state.hist1;
+		ctx->hist2 = state.hist2;
+	}
+	return true;
+}
+
+bool decode_adpcm(int16_t *out, const uint8_t *in, uint32_t numSamples, ADPCMContext *ctx) {
+	return decode_adpcm_tmpl(out, in, numSamples, ctx);
+}
+
+bool decode_adpcm(float *out, const uint8_t *in, uint32_t numSamples, ADPCMContext *ctx) {
+	return decode_adpcm_tmpl(out, in, numSamples, ctx);
+}
+
+bool get_adpcm_seek_table(
+	int16_t *table, const uint8_t *in, uint32_t numSamples, uint32_t interval, ADPCMContext *ctx
+) {
+	for (size_t pos = 0; pos < numSamples; pos += interval) {
+		*table++ = ctx->hist1;
+		*table++ = ctx->hist2;
+		if (!decode_adpcm((int16_t *)NULL, in + pos / 14 * 8, std::min<size_t>(interval, numSamples - pos), ctx)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <class T>
+static bool decode_adpcm_range_tmpl(
+	T *out, const uint8_t *in, uint32_t skip, uint32_t numSamples, ADPCMContext *ctx
+) {
+	uint32_t frames = skip / 14;
+	if (!decode_adpcm((int16_t *)NULL, in, frames * 14, ctx)) {
+		return false;
+	}
+	
+	in += frames * 8;
+	skip %= 14;
+	
+	/* The first frame is only partially requested */
+	if (skip) {
+		T scratch[14];
+		uint32_t head = std::min(14 - skip, numSamples);
+		if (!decode_adpcm(scratch, in, skip + head, ctx)) {
+			return false;
+		}
+		
+		memcpy(out, scratch + skip, head * sizeof(T));
+		in += 8;
+		out += head;
+		numSamples -= head;
+	}
+	
+	return decode_adpcm(out, in, numSamples, ctx);
+}
+
+bool decode_adpcm_range(
+	int16_t *out, const uint8_t *in, uint32_t skip, uint32_t numSamples, ADPCMContext *ctx
+) {
+	return decode_adpcm_range_tmpl(out, in, skip, numSamples, ctx);
+}
+
+bool decode_adpcm_range(
+	float *out, const uint8_t *in, uint32_t skip, uint32_t numSamples, ADPCMContext *ctx
+) {
+	return decode_adpcm_range_tmpl(out, in, skip, numSamples, ctx);
+}
+
+template <class T>
+static inline void store_samples(T *out, const int16_t *in, uint32_t count, uint32_t stride) {
+	for (uint32_t i = 0; i < count; i++) {
+		store_sample(&out[i * stride], in[i]);
+	}
+}
+
+template <class T>
+bool decode_adpcm_blocks_tmpl(
+	T *out, const uint8_t *in, uint32_t numSamples, uint32_t channels, uint32_t blockSize, ADPCMContext *contexts
+) {
+	/* Blocks are decoded in pieces that fit in the scratch buffer and are then scattered into the output */
+	const uint32_t pieceSamples = 14 * 32;
+	int16_t scratch[pieceSamples];
+	
+	size_t size = get_adpcm_size(numSamples);
+	uint32_t blockSamples = blockSize / 8 * 14;
+	
+	size_t offset = 0;
+	for (uint32_t pos = 0; pos < numSamples; pos += blockSamples) {
+		size_t length = std::min<size_t>(blockSize, size - offset);
+		size_t stride = length < blockSize ? get_last_block_size(size, blockSize) : blockSize;
+		uint32_t count = std::min(blockSamples, numSamples - pos);
+		
+		for (uint32_t chan = 0; chan < channels; chan++) {
+			const uint8_t *block = in + chan * stride;
+			T *dest = out + (size_t)pos * channels + chan;
+			for (uint32_t done = 0; done < count; done += pieceSamples) {
+				uint32_t piece = std::min(pieceSamples, count - done);
+				if (!decode_adpcm(scratch, block + done / 14 * 8, piece, &contexts[chan])) {
+					return false;
+				}
+				store_samples(dest + (size_t)done * channels, scratch, piece, channels);
+			}
+		}
+		
+		in += stride * channels;
+		offset += blockSize;
+	}
+	return true;
+}
+
+bool decode_adpcm_blocks(
+	int16_t *out, const uint8_t *in, uint32_t numSamples, uint32_t channels, uint32_t blockSize, ADPCMContext *contexts
+) {
+	return decode_adpcm_blocks_tmpl(out, in, numSamples, channels, blockSize, contexts);
+}
+
+bool decode_adpcm_blocks(
+	float *out, const uint8_t *in, uint32_t numSamples, uint32_t channels, uint32_t blockSize, ADPCMContext *contexts
+) {
+	return decode_adpcm_blocks_tmpl(out, in, numSamples, channels, blockSize, contexts);
+}
+
+void encode_adpcm(
+	uint8_t *out, const int16_t *in, uint32_t samples, ADPCMContext *ctx, uint32_t maxRecords,
+	uint32_t loopStart, ADPCMContext *loopCtx, bool draft, ADPCMStats *stats
+) {
+	dsptool::correlateCoefs(in, samples, ctx->coefs, maxRecords, draft);
+	encode_adpcm_frames(out, in, samples, ctx, loopStart, loopCtx, draft, stats);
+}
+
+void encode_adpcm_frames(
+	uint8_t *out, const int16_t *in, uint32_t samples, ADPCMContext *ctx,
+	uint32_t loopStart, ADPCMContext *loopCtx, bool draft, ADPCMStats *stats
+) {
+	dsptool::ADPCMINFO info;
+	memcpy(info.coef, ctx->coefs, sizeof(info.coef));
+	info.yn1 = ctx->hist1;
+	info.yn2 = ctx->hist2;
+	
+	dsptool::ENCODESTATS encodeStats;
+	dsptool::encodeFrames(in, out, &info, samples, loopStart, draft, stats ? &encodeStats : NULL);
+	
+	ctx->header = info.pred_scale;
+	
+	if (loopCtx) {
+		memcpy(loopCtx->coefs, ctx->coefs, sizeof(ctx->coefs));
+		loopCtx->header = info.loop_pred_scale;
+		loopCtx->hist1 = info.loop_yn1;
+		loopCtx->hist2 = info.loop_yn2;
+	}
+	
+	if (stats) {
+		stats->sse = encodeStats.sse;
+		stats->energy = encodeStats.energy;
+		stats->peak = encodeStats.peak;
+	}
+}
+
+size_t get_adpcm_size(size_t samples) {
+	size_t size = samples / 14 * 8;
+	if (samples % 14) {
+		size += (samples % 14 + 1) / 2 + 1;
+	}
+	return size;
+}
+
+}
@@ -0,0 +1,52 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+struct ADPCMContext {
+	int16_t coefs[16];
+	uint8_t header;
+	int16_t hist1;
+	int16_t hist2;
+};
+
+/* Squared error, signal energy and peak error of the decoded samples */
+struct ADPCMStats {
+	uint64_t sse;
+	uint64_t energy;
+	uint32_t peak;
+};
+
+int16_t clamp(int val);
+
+/* The float overloads write samples normalized to [-1, 1) */
+bool decode_adpcm(int16_t *out, const uint8_t *in, uint32_t numSamples, ADPCMContext *ctx);
+bool decode_adpcm(float *out, const uint8_t *in, uint32_t numSamples, ADPCMContext *ctx);
+bool get_adpcm_seek_table(int16_t *table, const uint8_t *in, uint32_t numSamples, uint32_t interval, ADPCMContext *ctx);
+bool decode_adpcm_range(int16_t *out, const uint8_t *in, uint32_t skip, uint32_t numSamples, ADPCMContext *ctx);
+bool decode_adpcm_range(float *out, const uint8_t *in, uint32_t skip, uint32_t numSamples, ADPCMContext *ctx);
+
+/* Decodes a stream whose channels are interleaved in blocks of blockSize bytes into interleaved samples */
+bool decode_adpcm_blocks(int16_t *out, const uint8_t *in, uint32_t numSamples, uint32_t channels, uint32_t blockSize, ADPCMContext *contexts);
+bool decode_adpcm_blocks(float *out, const uint8_t *in, uint32_t numSamples, uint32_t channels, uint32_t blockSize, ADPCMContext *contexts);
+
+/* Both functions start with the history samples in ctx. encode_adpcm estimates
+ * the coefficients first, encode_adpcm_frames uses the coefficients in ctx.
+ * If loopCtx is given it receives the decoder state at sample loopStart.
+ * Draft mode trades quality for encoding speed. If stats is given it receives
+ * the error statistics of the encoded stream, computed during encoding. */
+void encode_adpcm(
+	uint8_t *out, const int16_t *in, uint32_t samples, ADPCMContext *ctx, uint32_t maxRecords = 0,
+	uint32_t loopStart = 0, ADPCMContext *loopCtx = NULL, bool draft = false, ADPCMStats *stats = NULL
+);
+void encode_adpcm_frames(
+	uint8_t *out, const int16_t *in, uint32_t samples, ADPCMContext *ctx,
+	uint32_t loopStart = 0, ADPCMContext *loopCtx = NULL, bool draft = false, ADPCMStats *stats = NULL
+);
+
+size_t get_adpcm_size(size_t samples);
+
+}
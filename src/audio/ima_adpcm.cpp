@@ -0,0 +1,199 @@
+
+#include "audio/ima_adpcm.h"
+#include "audio/adpcm.h"
+#include "audio/sample.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+namespace audio {
+
+/* Decoding is cheap, so smaller inputs are decoded on the calling thread */
+static const size_t MIN_BYTES_PER_THREAD = 64 * 1024;
+
+static const int16_t ima_step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int ima_index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/* The difference and next step index for every step index and nybble */
+struct IMAADPCMTable {
+	int32_t diffs[89][16];
+	uint8_t indices[89][16];
+	
+	IMAADPCMTable() {
+		for (int index = 0; index < 89; index++) {
+			int step = ima_step_table[index];
+			for (int nybble = 0; nybble < 16; nybble++) {
+				int diff = step >> 3;
+				if (nybble & 1) diff += step >> 2;
+				if (nybble & 2) diff += step >> 1;
+				if (nybble & 4) diff += step;
+				diffs[index][nybble] = nybble & 8 ? -diff : diff;
+				indices[index][nybble] = std::min(std::max(index + ima_index_table[nybble], 0), 88);
+			}
+		}
+	}
+};
+
+static const IMAADPCMTable ima_adpcm_table;
+
+
+static inline int16_t decode_ima_adpcm_sample(int *predictor, int *index, int nybble) {
+	*predictor = clamp(*predictor + ima_adpcm_table.diffs[*index][nybble]);
+	*index = ima_adpcm_table.indices[*index][nybble];
+	return *predictor;
+}
+
+template <class T>
+static void decode_ima_adpcm_tmpl(T *out, const uint8_t *in, uint32_t numSamples, IMAADPCMContext *ctx) {
+	int predictor = ctx->predictor;
+	int index = ctx->index;
+	
+	for (uint32_t i = 0; i < numSamples / 2; i++) {
+		store_sample(&out[i * 2], decode_ima_adpcm_sample(&predictor, &index, in[i] & 0xF));
+		store_sample(&out[i * 2 + 1], decode_ima_adpcm_sample(&predictor, &index, in[i] >> 4));
+	}
+	if (numSamples % 2) {
+		store_sample(&out[numSamples - 1], decode_ima_adpcm_sample(&predictor, &index, in[numSamples / 2] & 0xF));
+	}
+	
+	ctx->predictor = predictor;
+	ctx->index = index;
+}
+
+void decode_ima_adpcm(int16_t *out, const uint8_t *in, uint32_t numSamples, IMAADPCMContext *ctx) {
+	decode_ima_adpcm_tmpl(out, in, numSamples, ctx);
+}
+
+void decode_ima_adpcm(float *out, const uint8_t *in, uint32_t numSamples, IMAADPCMContext *ctx) {
+	decode_ima_adpcm_tmpl(out, in, numSamples, ctx);
+}
+
+static inline int encode_ima_adpcm_sample(int *predictor, int *index, int sample) {
+	int step = ima_step_table[*index];
+	int diff = sample - *predictor;
+	
+	int nybble = 0;
+	if (diff < 0) {
+		nybble = 8;
+		diff = -diff;
+	}
+	
+	if (diff >= step) {
+		nybble |= 4;
+		diff -= step;
+	}
+	if (diff >= step >> 1) {
+		nybble |= 2;
+		diff -= step >> 1;
+	}
+	if (diff >= step >> 2) {
+		nybble |= 1;
+	}
+	
+	/* The encoder tracks the decoder output so that rounding errors do not accumulate */
+	decode_ima_adpcm_sample(predictor, index, nybble);
+	return nybble;
+}
+
+template <bool Swap>
+static inline int16_t load_sample(const int16_t *in) {
+	return Swap ? swap_sample(*in) : *in;
+}
+
+template <bool Swap>
+static void encode_ima_adpcm_tmpl(uint8_t *out, const int16_t *in, uint32_t numSamples, IMAADPCMContext *ctx) {
+	int predictor = ctx->predictor;
+	int index = ctx->index;
+	
+	for (uint32_t i = 0; i < numSamples / 2; i++) {
+		int lo = encode_ima_adpcm_sample(&predictor, &index, load_sample<Swap>(&in[i * 2]));
+		int hi = encode_ima_adpcm_sample(&predictor, &index, load_sample<Swap>(&in[i * 2 + 1]));
+		out[i] = lo | (hi << 4);
+	}
+	if (numSamples % 2) {
+		out[numSamples / 2] = encode_ima_adpcm_sample(&predictor, &index, load_sample<Swap>(&in[numSamples - 1]));
+	}
+	
+	ctx->predictor = predictor;
+	ctx->index = index;
+}
+
+void encode_ima_adpcm(uint8_t *out, const int16_t *in, uint32_t numSamples, IMAADPCMContext *ctx, bool swap) {
+	if (swap) encode_ima_adpcm_tmpl<true>(out, in, numSamples, ctx);
+	else encode_ima_adpcm_tmpl<false>(out, in, numSamples, ctx);
+}
+
+size_t get_ima_adpcm_size(size_t samples) {
+	return (samples + 1) / 2;
+}
+
+size_t get_ima_adpcm_block_samples(size_t size, uint32_t channels, uint32_t blockSize) {
+	size_t stride = (size_t)blockSize * channels;
+	size_t last = size % stride / channels;
+	size_t samples = size / stride * (blockSize - 4) * 2;
+	if (last > 4) {
+		samples += (last - 4) * 2;
+	}
+	return samples;
+}
+
+template <class T>
+static void decode_ima_adpcm_blocks_tmpl(T *out, const uint8_t *in, size_t size, uint32_t channels, uint32_t blockSize) {
+	size_t stride = (size_t)blockSize * channels;
+	size_t blocks = (size + stride - 1) / stride;
+	uint32_t blockSamples = (blockSize - 4) * 2;
+	size_t threads = get_thread_count(size, MIN_BYTES_PER_THREAD);
+	
+	parallel_for(blocks * channels, [=](size_t i) {
+		size_t block = i / channels;
+		uint32_t chan = i % channels;
+		
+		size_t length = std::min<size_t>(blockSize, (size - block * stride) / channels);
+		if (length <= 4) return;
+		
+		const uint8_t *data = in + block * stride + chan * length;
+		
+		IMAADPCMContext ctx;
+		ctx.predictor = (int16_t)(data[0] | (data[1] << 8));
+		ctx.index = std::min<uint8_t>(data[2], 88);
+		
+		uint32_t count = (length - 4) * 2;
+		T *dest = out + block * blockSamples * channels + chan;
+		if (channels == 1) {
+			decode_ima_adpcm_tmpl(dest, data + 4, count, &ctx);
+			return;
+		}
+		
+		/* Samples are decoded in pieces and then scattered into the interleaved output */
+		const uint32_t pieceSamples = 512;
+		T scratch[pieceSamples];
+		
+		for (uint32_t done = 0; done < count; done += pieceSamples) {
+			uint32_t piece = std::min(pieceSamples, count - done);
+			decode_ima_adpcm_tmpl(scratch, data + 4 + done / 2, piece, &ctx);
+			for (uint32_t j = 0; j < piece; j++) {
+				dest[(size_t)(done + j) * channels] = scratch[j];
+			}
+		}
+	}, threads);
+}
+
+void decode_ima_adpcm_blocks(int16_t *out, const uint8_t *in, size_t size, uint32_t channels, uint32_t blockSize) {
+	decode_ima_adpcm_blocks_tmpl(out, in, size, channels, blockSize);
+}
+
+void decode_ima_adpcm_blocks(float *out, const uint8_t *in, size_t size, uint32_t channels, uint32_t blockSize) {
+	decode_ima_adpcm_blocks_tmpl(out, in, size, channels, blockSize);
+}
+
+}
@@ -0,0 +1,32 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+struct IMAADPCMContext {
+	int16_t predictor;
+	uint8_t index;
+};
+
+/* Samples are stored as 4-bit nybbles, low nybble first. If the number of
+ * samples is odd the high nybble of the last byte is not used. The encoder
+ * swaps the byte order of the input samples if swap is set. */
+void decode_ima_adpcm(int16_t *out, const uint8_t *in, uint32_t numSamples, IMAADPCMContext *ctx);
+void decode_ima_adpcm(float *out, const uint8_t *in, uint32_t numSamples, IMAADPCMContext *ctx);
+void encode_ima_adpcm(uint8_t *out, const int16_t *in, uint32_t numSamples, IMAADPCMContext *ctx, bool swap = false);
+
+size_t get_ima_adpcm_size(size_t samples);
+
+/* In the block variant every block starts with a 4 byte header that resets
+ * the decoder: the predictor (int16, little-endian), the step index and a
+ * padding byte. The channels are interleaved per block and the last block
+ * of every channel may be shorter than blockSize. The blocks are decoded
+ * on worker threads into interleaved samples. */
+size_t get_ima_adpcm_block_samples(size_t size, uint32_t channels, uint32_t blockSize);
+void decode_ima_adpcm_blocks(int16_t *out, const uint8_t *in, size_t size, uint32_t channels, uint32_t blockSize);
+void decode_ima_adpcm_blocks(float *out, const uint8_t *in, size_t size, uint32_t channels, uint32_t blockSize);
+
+}
@@ -0,0 +1,296 @@
+
+#include "audio/interleave.h"
+#include "audio/sample.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audio {
+
+/* Stream files align the last block of every channel to 0x20 bytes */
+size_t get_last_block_size(size_t size, size_t block_size) {
+	size_t last = size - (size - 1) / block_size * block_size;
+	return (last + 0x1F) & ~0x1F;
+}
+
+size_t get_block_interleaved_size(size_t size, size_t channels, size_t block_size) {
+	if (!size) return 0;
+	size_t blocks = (size - 1) / block_size;
+	return (blocks * block_size + get_last_block_size(size, block_size)) * channels;
+}
+
+void interleave_blocks(uint8_t *out, uint8_t **channels, size_t count, size_t size, size_t block_size) {
+	for (size_t offset = 0; offset < size; offset += block_size) {
+		size_t length = std::min(block_size, size - offset);
+		size_t stride = length < block_size ? get_last_block_size(size, block_size) : block_size;
+		for (size_t i = 0; i < count; i++) {
+			memcpy(out, channels[i] + offset, length);
+			memset(out + length, 0, stride - length);
+			out += stride;
+		}
+	}
+}
+
+template <bool Swap>
+static inline int16_t convert(int16_t sample) {
+	return Swap ? swap_sample(sample) : sample;
+}
+
+template <size_t Count, bool Swap>
+static void interleave_fixed(int16_t *out, const int16_t *const *channels, size_t start, size_t samples) {
+	for (size_t i = start; i < samples; i++) {
+		for (size_t j = 0; j < Count; j++) {
+			out[i * Count + j] = convert<Swap>(channels[j][i]);
+		}
+	}
+}
+
+template <size_t Count, bool Swap>
+static void deinterleave_fixed(int16_t *const *out, const int16_t *in, size_t start, size_t samples) {
+	for (size_t i = start; i < samples; i++) {
+		for (size_t j = 0; j < Count; j++) {
+			out[j][i] = convert<Swap>(in[i * Count + j]);
+		}
+	}
+}
+
+template <bool Swap>
+static void interleave_generic(int16_t *out, const int16_t *const *channels, size_t count, size_t samples) {
+	for (size_t i = 0; i < samples; i++) {
+		for (size_t j = 0; j < count; j++) {
+			out[i * count + j] = convert<Swap>(channels[j][i]);
+		}
+	}
+}
+
+template <bool Swap>
+static void deinterleave_generic(int16_t *const *out, const int16_t *in, size_t count, size_t samples) {
+	for (size_t i = 0; i < samples; i++) {
+		for (size_t j = 0; j < count; j++) {
+			out[j][i] = convert<Swap>(in[i * count + j]);
+		}
+	}
+}
+
+#ifdef HAVE_SSE2
+/* Byte swapping is applied while loading, before the samples are shuffled */
+template <bool Swap>
+static inline __m128i load(const int16_t *ptr) {
+	__m128i value = _mm_loadu_si128((const __m128i *)ptr);
+	if (Swap) {
+		value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+	}
+	return value;
+}
+
+static inline void store(int16_t *ptr, __m128i value) {
+	_mm_storeu_si128((__m128i *)ptr, value);
+}
+
+/* Transposes 8 rows of 8 samples, which is its own inverse */
+static inline void transpose8x8(__m128i *r) {
+	__m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+	__m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+	__m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+	__m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+	__m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+	__m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+	__m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+	__m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+	
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	__m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	__m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	__m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	__m128i b7 = _mm_unpackhi_epi32(a5, a7);
+	
+	r[0] = _mm_unpacklo_epi64(b0, b4);
+	r[1] = _mm_unpackhi_epi64(b0, b4);
+	r[2] = _mm_unpacklo_epi64(b1, b5);
+	r[3] = _mm_unpackhi_epi64(b1, b5);
+	r[4] = _mm_unpacklo_epi64(b2, b6);
+	r[5] = _mm_unpackhi_epi64(b2, b6);
+	r[6] = _mm_unpacklo_epi64(b3, b7);
+	r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+template <bool Swap>
+static size_t interleave_sse2(int16_t *out, const int16_t *const *channels, size_t count, size_t samples) {
+	size_t i = 0;
+	if (count == 2) {
+		for (; i + 8 <= samples; i += 8) {
+			__m128i a = load<Swap>(channels[0] + i);
+			__m128i b = load<Swap>(channels[1] + i);
+			store(out + i * 2, _mm_unpacklo_epi16(a, b));
+			store(out + i * 2 + 8, _mm_unpackhi_epi16(a, b));
+		}
+	}
+	else if (count == 4) {
+		for (; i + 8 <= samples; i += 8) {
+			__m128i ab0 = _mm_unpacklo_epi16(load<Swap>(channels[0] + i), load<Swap>(channels[1] + i));
+			__m128i ab1 = _mm_unpackhi_epi16(load<Swap>(channels[0] + i), load<Swap>(channels[1] + i));
+			__m128i cd0 = _mm_unpacklo_epi16(load<Swap>(channels[2] + i), load<Swap>(channels[3] + i));
+			__m128i cd1 = _mm_unpackhi_epi16(load<Swap>(channels[2] + i), load<Swap>(channels[3] + i));
+			store(out + i * 4, _mm_unpacklo_epi32(ab0, cd0));
+			store(out + i * 4 + 8, _mm_unpackhi_epi32(ab0, cd0));
+			store(out + i * 4 + 16, _mm_unpacklo_epi32(ab1, cd1));
+			store(out + i * 4 + 24, _mm_unpackhi_epi32(ab1, cd1));
+		}
+	}
+	else if (count == 8) {
+		for (; i + 8 <= samples; i += 8) {
+			__m128i r[8];
+			for (size_t j = 0; j < 8; j++) {
+				r[j] = load<Swap>(channels[j] + i);
+			}
+			transpose8x8(r);
+			for (size_t j = 0; j < 8; j++) {
+				store(out + (i + j) * 8, r[j]);
+			}
+		}
+	}
+	return i;
+}
+
+template <bool Swap>
+static size_t deinterleave_sse2(int16_t *const *out, const int16_t *in, size_t count, size_t samples) {
+	size_t i = 0;
+	if (count == 2) {
+		for (; i + 8 <= samples; i += 8) {
+			__m128i v0 = load<Swap>(in + i * 2);
+			__m128i v1 = load<Swap>(in + i * 2 + 8);
+			__m128i a0 = _mm_srai_epi32(_mm_slli_epi32(v0, 16), 16);
+			__m128i a1 = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+			store(out[0] + i, _mm_packs_epi32(a0, a1));
+			store(out[1] + i, _mm_packs_epi32(_mm_srai_epi32(v0, 16), _mm_srai_epi32(v1, 16)));
+		}
+	}
+	else if (count == 4) {
+		for (; i + 8 <= samples; i += 8) {
+			__m128i v0 = load<Swap>(in + i * 4);
+			__m128i v1 = load<Swap>(in + i * 4 + 8);
+			__m128i v2 = load<Swap>(in + i * 4 + 16);
+			__m128i v3 = load<Swap>(in + i * 4 + 24);
+			
+			__m128i t0 = _mm_unpacklo_epi16(v0, v1);
+			__m128i t1 = _mm_unpackhi_epi16(v0, v1);
+			__m128i t2 = _mm_unpacklo_epi16(v2, v3);
+			__m128i t3 = _mm_unpackhi_epi16(v2, v3);
+			
+			__m128i u0 = _mm_unpacklo_epi16(t0, t1);
+			__m128i u1 = _mm_unpackhi_epi16(t0, t1);
+			__m128i u2 = _mm_unpacklo_epi16(t2, t3);
+			__m128i u3 = _mm_unpackhi_epi16(t2, t3);
+			
+			store(out[0] + i, _mm_unpacklo_epi64(u0, u2));
+			store(out[1] + i, _mm_unpackhi_epi64(u0, u2));
+			store(out[2] + i, _mm_unpacklo_epi64(u1, u3));
+			store(out[3] + i, _mm_unpackhi_epi64(u1, u3));
+		}
+	}
+	else if (count == 8) {
+		for (; i + 8 <= samples; i += 8) {
+			__m128i r[8];
+			for (size_t j = 0; j < 8; j++) {
+				r[j] = load<Swap>(in + (i + j) * 8);
+			}
+			transpose8x8(r);
+			for (size_t j = 0; j < 8; j++) {
+				store(out[j] + i, r[j]);
+			}
+		}
+	}
+	return i;
+}
+#endif
+
+template <bool Swap>
+static void interleave_samples(int16_t *out, const int16_t *const *channels, size_t count, size_t samples) {
+	size_t start = 0;
+#ifdef HAVE_SSE2
+	start = interleave_sse2<Swap>(out, channels, count, samples);
+#endif
+	
+	switch (count) {
+		case 2: interleave_fixed<2, Swap>(out, channels, start, samples); break;
+		case 4: interleave_fixed<4, Swap>(out, channels, start, samples); break;
+		case 6: interleave_fixed<6, Swap>(out, channels, start, samples); break;
+		case 8: interleave_fixed<8, Swap>(out, channels, start, samples); break;
+		default: interleave_generic<Swap>(out, channels, count, samples); break;
+	}
+}
+
+template <bool Swap>
+static void deinterleave_samples(int16_t *const *out, const int16_t *in, size_t count, size_t samples) {
+	size_t start = 0;
+#ifdef HAVE_SSE2
+	start = deinterleave_sse2<Swap>(out, in, count, samples);
+#endif
+	
+	switch (count) {
+		case 2: deinterleave_fixed<2, Swap>(out, in, start, samples); break;
+		case 4: deinterleave_fixed<4, Swap>(out, in, start, samples); break;
+		case 6: deinterleave_fixed<6, Swap>(out, in, start, samples); break;
+		case 8: deinterleave_fixed<8, Swap>(out, in, start, samples); break;
+		default: deinterleave_generic<Swap>(out, in, count, samples); break;
+	}
+}
+
+template <bool Swap>
+static void copy_samples(int16_t *out, const int16_t *in, size_t count) {
+	if (!Swap) {
+		memcpy(out, in, count * 2);
+		return;
+	}
+	for (size_t i = 0; i < count; i++) {
+		out[i] = swap_sample(in[i]);
+	}
+}
+
+template <bool Swap>
+static void interleave_tmpl(int16_t *out, const int16_t *const *channels, size_t count, size_t samples, size_t block_size) {
+	if (block_size == 1) {
+		interleave_samples<Swap>(out, channels, count, samples);
+		return;
+	}
+	
+	for (size_t offset = 0; offset < samples; offset += block_size) {
+		size_t length = std::min(block_size, samples - offset);
+		for (size_t i = 0; i < count; i++) {
+			copy_samples<Swap>(out, channels[i] + offset, length);
+			out += length;
+		}
+	}
+}
+
+template <bool Swap>
+static void deinterleave_tmpl(int16_t *const *out, const int16_t *in, size_t count, size_t samples, size_t block_size) {
+	if (block_size == 1) {
+		deinterleave_samples<Swap>(out, in, count, samples);
+		return;
+	}
+	
+	for (size_t offset = 0; offset < samples; offset += block_size) {
+		size_t length = std::min(block_size, samples - offset);
+		for (size_t i = 0; i < count; i++) {
+			copy_samples<Swap>(out[i] + offset, in, length);
+			in += length;
+		}
+	}
+}
+
+void interleave(int16_t *out, const int16_t *const *channels, size_t count, size_t samples, size_t block_size, bool swap) {
+	if (swap) interleave_tmpl<true>(out, channels, count, samples, block_size);
+	else interleave_tmpl<false>(out, channels, count, samples, block_size);
+}
+
+void deinterleave(int16_t *const *out, const int16_t *in, size_t count, size_t samples, size_t block_size, bool swap) {
+	if (swap) deinterleave_tmpl<true>(out, in, count, samples, block_size);
+	else deinterleave_tmpl<false>(out, in, count, samples, block_size);
+}
+
+}
@@ -0,0 +1,19 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+size_t get_last_block_size(size_t size, size_t block_size);
+size_t get_block_interleaved_size(size_t size, size_t channels, size_t block_size);
+
+void interleave_blocks(uint8_t *out, uint8_t **channels, size_t count, size_t size, size_t block_size);
+
+/* Interleaves PCM-16 channels per sample, or in blocks of block_size samples.
+ * If swap is set the byte order of every sample is swapped as well. */
+void interleave(int16_t *out, const int16_t *const *channels, size_t count, size_t samples, size_t block_size = 1, bool swap = false);
+void deinterleave(int16_t *const *out, const int16_t *in, size_t count, size_t samples, size_t block_size = 1, bool swap = false);
+
+}
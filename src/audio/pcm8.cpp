@@ -0,0 +1,268 @@
+
+#include "audio/pcm8.h"
+#include "audio/sample.h"
+#include "simd.h"
+
+#include <algorithm>
+
+namespace audio {
+
+/* The deinterleaving functions convert this many samples at a time */
+static const size_t PIECE_SAMPLES = 1024;
+
+template <bool Swap>
+static inline int8_t encode_sample(int16_t sample) {
+	if (Swap) {
+		sample = swap_sample(sample);
+	}
+	if (sample < 0x7F80) {
+		sample += 0x80;
+	}
+	return sample >> 8;
+}
+
+template <class T>
+static void decode_scalar(T *out, const int8_t *in, size_t start, size_t samples) {
+	for (size_t i = start; i < samples; i++) {
+		store_sample(&out[i], in[i] << 8);
+	}
+}
+
+template <bool Swap>
+static void encode_scalar(int8_t *out, const int16_t *in, size_t start, size_t samples) {
+	for (size_t i = start; i < samples; i++) {
+		out[i] = encode_sample<Swap>(in[i]);
+	}
+}
+
+#ifdef HAVE_SSE2
+static size_t decode_sse2(int16_t *out, const int8_t *in, size_t samples) {
+	__m128i zero = _mm_setzero_si128();
+	
+	size_t i = 0;
+	for (; i + 16 <= samples; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi8(zero, v));
+		_mm_storeu_si128((__m128i *)(out + i + 8), _mm_unpackhi_epi8(zero, v));
+	}
+	return i;
+}
+
+static size_t decode_sse2(float *out, const int8_t *in, size_t samples) {
+	__m128i zero = _mm_setzero_si128();
+	__m128 scale = _mm_set1_ps(1.0f / 32768);
+	
+	size_t i = 0;
+	for (; i + 16 <= samples; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i lo = _mm_unpacklo_epi8(zero, v);
+		__m128i hi = _mm_unpackhi_epi8(zero, v);
+		
+		/* Sign extends the PCM-16 samples to 32 bits */
+		__m128i s0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16);
+		__m128i s1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16);
+		__m128i s2 = _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16);
+		__m128i s3 = _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16);
+		
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(s0), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(s1), scale));
+		_mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(s2), scale));
+		_mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(s3), scale));
+	}
+	return i;
+}
+
+template <bool Swap>
+static inline __m128i load_sse2(const int16_t *ptr) {
+	__m128i value = _mm_loadu_si128((const __m128i *)ptr);
+	if (Swap) {
+		value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+	}
+	return value;
+}
+
+/* The saturating addition implements the clamping of encode_sample */
+template <bool Swap>
+static size_t encode_sse2(int8_t *out, const int16_t *in, size_t samples) {
+	__m128i bias = _mm_set1_epi16(0x80);
+	
+	size_t i = 0;
+	for (; i + 16 <= samples; i += 16) {
+		__m128i a = _mm_srai_epi16(_mm_adds_epi16(load_sse2<Swap>(in + i), bias), 8);
+		__m128i b = _mm_srai_epi16(_mm_adds_epi16(load_sse2<Swap>(in + i + 8), bias), 8);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(a, b));
+	}
+	return i;
+}
+#endif
+
+#ifdef HAVE_AVX2
+TARGET_AVX2
+static size_t decode_avx2(int16_t *out, const int8_t *in, size_t samples) {
+	size_t i = 0;
+	for (; i + 32 <= samples; i += 32) {
+		__m256i a = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(in + i)));
+		__m256i b = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(in + i + 16)));
+		_mm256_storeu_si256((__m256i *)(out + i), _mm256_slli_epi16(a, 8));
+		_mm256_storeu_si256((__m256i *)(out + i + 16), _mm256_slli_epi16(b, 8));
+	}
+	return i;
+}
+
+TARGET_AVX2
+static size_t decode_avx2(float *out, const int8_t *in, size_t samples) {
+	__m256 scale = _mm256_set1_ps(1.0f / 128);
+	
+	size_t i = 0;
+	for (; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(in + i)));
+		__m256i b = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(in + i + 8)));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), scale));
+		_mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), scale));
+	}
+	return i;
+}
+
+template <bool Swap>
+TARGET_AVX2
+static inline __m256i load_avx2(const int16_t *ptr) {
+	__m256i value = _mm256_loadu_si256((const __m256i *)ptr);
+	if (Swap) {
+		value = _mm256_or_si256(_mm256_slli_epi16(value, 8), _mm256_srli_epi16(value, 8));
+	}
+	return value;
+}
+
+template <bool Swap>
+TARGET_AVX2
+static size_t encode_avx2(int8_t *out, const int16_t *in, size_t samples) {
+	__m256i bias = _mm256_set1_epi16(0x80);
+	
+	size_t i = 0;
+	for (; i + 32 <= samples; i += 32) {
+		__m256i a = _mm256_srai_epi16(_mm256_adds_epi16(load_avx2<Swap>(in + i), bias), 8);
+		__m256i b = _mm256_srai_epi16(_mm256_adds_epi16(load_avx2<Swap>(in + i + 16), bias), 8);
+		
+		/* Packing works within 128-bit lanes, so the quarters must be put back in order */
+		__m256i packed = _mm256_packs_epi16(a, b);
+		_mm256_storeu_si256((__m256i *)(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+	}
+	return i;
+}
+#endif
+
+template <class T>
+static void decode_pcm8_tmpl(T *out, const int8_t *in, size_t samples) {
+	size_t i = 0;
+#ifdef HAVE_AVX2
+	if (cpu_has_avx2()) {
+		i = decode_avx2(out, in, samples);
+	}
+#endif
+#ifdef HAVE_SSE2
+	i += decode_sse2(out + i, in + i, samples - i);
+#endif
+	decode_scalar(out, in, i, samples);
+}
+
+template <bool Swap>
+static void encode_pcm8_tmpl(int8_t *out, const int16_t *in, size_t samples) {
+	size_t i = 0;
+#ifdef HAVE_AVX2
+	if (cpu_has_avx2()) {
+		i = encode_avx2<Swap>(out, in, samples);
+	}
+#endif
+#ifdef HAVE_SSE2
+	i += encode_sse2<Swap>(out + i, in + i, samples - i);
+#endif
+	encode_scalar<Swap>(out, in, i, samples);
+}
+
+static void encode_pcm8_any(int8_t *out, const int16_t *in, size_t samples, bool swap) {
+	if (swap) encode_pcm8_tmpl<true>(out, in, samples);
+	else encode_pcm8_tmpl<false>(out, in, samples);
+}
+
+/* Distributes a piece of interleaved samples over the channel buffers. The
+ * position of the next sample is tracked in chan and frame. */
+template <class T>
+static void scatter(T *const *out, const T *in, size_t count, size_t samples, size_t *chan, size_t *frame) {
+	size_t c = *chan;
+	size_t f = *frame;
+	
+	size_t i = 0;
+	if (count == 2 && c == 0) {
+		for (; i + 2 <= samples; i += 2, f++) {
+			out[0][f] = in[i];
+			out[1][f] = in[i + 1];
+		}
+	}
+	for (; i < samples; i++) {
+		out[c][f] = in[i];
+		if (++c == count) {
+			c = 0;
+			f++;
+		}
+	}
+	
+	*chan = c;
+	*frame = f;
+}
+
+template <class T>
+static void decode_pcm8_tmpl(T *const *out, const int8_t *in, size_t count, size_t samples) {
+	if (count == 1) {
+		decode_pcm8_tmpl(out[0], in, samples);
+		return;
+	}
+	
+	T scratch[PIECE_SAMPLES];
+	size_t total = count * samples;
+	size_t chan = 0;
+	size_t frame = 0;
+	for (size_t pos = 0; pos < total; pos += PIECE_SAMPLES) {
+		size_t piece = std::min(PIECE_SAMPLES, total - pos);
+		decode_pcm8_tmpl(scratch, in + pos, piece);
+		scatter(out, scratch, count, piece, &chan, &frame);
+	}
+}
+
+void decode_pcm8(int16_t *out, const int8_t *in, size_t samples) {
+	decode_pcm8_tmpl(out, in, samples);
+}
+
+void decode_pcm8(float *out, const int8_t *in, size_t samples) {
+	decode_pcm8_tmpl(out, in, samples);
+}
+
+void encode_pcm8(int8_t *out, const int16_t *in, size_t samples, bool swap) {
+	encode_pcm8_any(out, in, samples, swap);
+}
+
+void decode_pcm8(int16_t *const *out, const int8_t *in, size_t count, size_t samples) {
+	decode_pcm8_tmpl(out, in, count, samples);
+}
+
+void decode_pcm8(float *const *out, const int8_t *in, size_t count, size_t samples) {
+	decode_pcm8_tmpl(out, in, count, samples);
+}
+
+void encode_pcm8(int8_t *const *out, const int16_t *in, size_t count, size_t samples, bool swap) {
+	if (count == 1) {
+		encode_pcm8_any(out[0], in, samples, swap);
+		return;
+	}
+	
+	int8_t scratch[PIECE_SAMPLES];
+	size_t total = count * samples;
+	size_t chan = 0;
+	size_t frame = 0;
+	for (size_t pos = 0; pos < total; pos += PIECE_SAMPLES) {
+		size_t piece = std::min(PIECE_SAMPLES, total - pos);
+		encode_pcm8_any(scratch, in + pos, piece, swap);
+		scatter(out, (const int8_t *)scratch, count, piece, &chan, &frame);
+	}
+}
+
+}
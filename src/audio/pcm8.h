@@ -0,0 +1,22 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+/* PCM-16 samples are rounded to the nearest PCM-8 sample, except that samples
+ * which would round up to 128 are truncated to 127 instead. The float overloads
+ * write samples normalized to [-1, 1). */
+void decode_pcm8(int16_t *out, const int8_t *in, size_t samples);
+void decode_pcm8(float *out, const int8_t *in, size_t samples);
+void encode_pcm8(int8_t *out, const int16_t *in, size_t samples, bool swap = false);
+
+/* Same as above, but the input contains count interleaved channels, which are
+ * written to separate buffers. samples is the number of samples per channel. */
+void decode_pcm8(int16_t *const *out, const int8_t *in, size_t count, size_t samples);
+void decode_pcm8(float *const *out, const int8_t *in, size_t count, size_t samples);
+void encode_pcm8(int8_t *const *out, const int16_t *in, size_t count, size_t samples, bool swap = false);
+
+}
@@ -0,0 +1,309 @@
+
+#include "audio/resample.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace audio {
+
+/* Ratios with more phases than this share the nearest of MAX_PHASES + 1 precomputed phases */
+static const uint32_t MAX_PHASES = 4096;
+
+/* Number of zero crossings of the sinc function on either side of the center */
+static const double ZERO_CROSSINGS = 16;
+static const double KAISER_BETA = 8.0;
+
+/* The cutoff frequency relative to the lower of the two Nyquist frequencies */
+static const double CUTOFF = 0.95;
+
+static const uint32_t CHUNK_FRAMES = 4096;
+
+static const double PI = 3.14159265358979323846;
+
+static double bessel_i0(double x) {
+	double sum = 1;
+	double term = 1;
+	for (int k = 1; k < 50; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if (term < sum * 1e-17) break;
+	}
+	return sum;
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/* Every row covers the input samples [start - taps / 2 + 1, start + taps / 2]
+ * of an output sample at start + phase / phases. There is one extra row for
+ * a phase of exactly 1, which is reached by rounding to the nearest phase. */
+static void build_filter(Resampler *resampler) {
+	double cutoff = std::min(1.0, (double)resampler->up / resampler->down) * CUTOFF;
+	double support = ZERO_CROSSINGS / cutoff;
+	double norm = bessel_i0(KAISER_BETA);
+	
+	uint32_t taps = resampler->taps;
+	int center = taps / 2 - 1;
+	for (uint32_t phase = 0; phase <= resampler->phases; phase++) {
+		float *row = resampler->filter + phase * taps;
+		double offset = (double)phase / resampler->phases;
+		
+		double sum = 0;
+		for (uint32_t i = 0; i < taps; i++) {
+			double x = (int)i - center - offset;
+			double value = 0;
+			if (std::fabs(x) <= support) {
+				double t = x / support;
+				double window = bessel_i0(KAISER_BETA * std::sqrt(1 - t * t)) / norm;
+				double y = PI * cutoff * x;
+				value = (y == 0 ? 1 : std::sin(y) / y) * window;
+			}
+			row[i] = value;
+			sum += value;
+		}
+		
+		/* Every phase passes DC with unity gain */
+		for (uint32_t i = 0; i < taps; i++) {
+			row[i] /= sum;
+		}
+	}
+}
+
+bool init_resampler(Resampler *resampler, uint32_t inRate, uint32_t outRate, uint32_t channels) {
+	memset(resampler, 0, sizeof(Resampler));
+	
+	uint32_t div = gcd(inRate, outRate);
+	resampler->channels = channels;
+	resampler->up = outRate / div;
+	resampler->down = inRate / div;
+	resampler->phases = std::min(resampler->up, MAX_PHASES);
+	
+	/* The taps are padded to a multiple of 8 for the SIMD loops */
+	double cutoff = std::min(1.0, (double)resampler->up / resampler->down) * CUTOFF;
+	uint32_t taps = (uint32_t)std::ceil(ZERO_CROSSINGS / cutoff) * 2 + 2;
+	resampler->taps = (taps + 7) & ~7;
+	
+	resampler->capacity = resampler->taps + CHUNK_FRAMES;
+	resampler->filter = (float *)malloc((size_t)(resampler->phases + 1) * resampler->taps * sizeof(float));
+	resampler->buffer = (float *)malloc((size_t)resampler->capacity * channels * sizeof(float));
+	if (!resampler->filter || !resampler->buffer) {
+		free_resampler(resampler);
+		return false;
+	}
+	
+	build_filter(resampler);
+	reset_resampler(resampler);
+	return true;
+}
+
+void free_resampler(Resampler *resampler) {
+	free(resampler->filter);
+	free(resampler->buffer);
+	resampler->filter = NULL;
+	resampler->buffer = NULL;
+}
+
+void reset_resampler(Resampler *resampler) {
+	/* The first output sample is aligned with the first input sample */
+	resampler->length = resampler->taps / 2 - 1;
+	for (uint32_t chan = 0; chan < resampler->channels; chan++) {
+		memset(resampler->buffer + (size_t)chan * resampler->capacity, 0, resampler->length * sizeof(float));
+	}
+	resampler->time = 0;
+	resampler->inputs = 0;
+	resampler->outputs = 0;
+}
+
+static size_t get_output_count(const Resampler *resampler, uint64_t length) {
+	if (length < resampler->taps) return 0;
+	
+	uint64_t end = (length - resampler->taps + 1) * resampler->up;
+	if (end <= resampler->time) return 0;
+	return (end - resampler->time + resampler->down - 1) / resampler->down;
+}
+
+size_t get_resample_count(const Resampler *resampler, size_t frames) {
+	return get_output_count(resampler, (uint64_t)resampler->length + frames);
+}
+
+size_t get_flush_count(const Resampler *resampler) {
+	uint64_t total = (resampler->inputs * resampler->up + resampler->down - 1) / resampler->down;
+	return total - resampler->outputs;
+}
+
+/* Every implementation keeps eight partial sums and adds them up in the same
+ * order, so that the output does not depend on the CPU */
+#ifndef HAVE_SSE2
+static float dot_product(const float *a, const float *b, uint32_t count) {
+	float sum[8] = {};
+	for (uint32_t i = 0; i < count; i += 8) {
+		for (uint32_t j = 0; j < 8; j++) {
+			sum[j] += a[i + j] * b[i + j];
+		}
+	}
+	for (uint32_t j = 0; j < 4; j++) {
+		sum[j] += sum[j + 4];
+	}
+	return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+}
+#endif
+
+#ifdef HAVE_SSE2
+static float dot_product_sse2(const float *a, const float *b, uint32_t count) {
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	for (uint32_t i = 0; i < count; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	__m128 sum = _mm_add_ps(sum0, sum1);
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+}
+#endif
+
+#ifdef HAVE_AVX2
+TARGET_AVX2
+static float dot_product_avx2(const float *a, const float *b, uint32_t count) {
+	__m256 sum = _mm256_setzero_ps();
+	for (uint32_t i = 0; i < count; i += 8) {
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+	return _mm_cvtss_f32(half);
+}
+#endif
+
+typedef float (*DotProductFunc)(const float *a, const float *b, uint32_t count);
+
+static DotProductFunc get_dot_product_func() {
+#ifdef HAVE_AVX2
+	if (cpu_has_avx2()) {
+		return dot_product_avx2;
+	}
+#endif
+#ifdef HAVE_SSE2
+	return dot_product_sse2;
+#else
+	return dot_product;
+#endif
+}
+
+static const DotProductFunc dot_product_func = get_dot_product_func();
+
+static inline void store_output(int16_t *out, float value) {
+	value = std::min(std::max(value, -32768.0f), 32767.0f);
+	*out = (int16_t)std::lrint(value);
+}
+
+static inline void store_output(float *out, float value) {
+	*out = value * (1.0f / 32768);
+}
+
+template <class T>
+static T *produce(Resampler *resampler, T *out, size_t count) {
+	uint32_t channels = resampler->channels;
+	uint32_t taps = resampler->taps;
+	
+	for (size_t i = 0; i < count; i++) {
+		uint64_t start = resampler->time / resampler->up;
+		uint64_t frac = resampler->time % resampler->up;
+		uint32_t phase = (frac * resampler->phases + resampler->up / 2) / resampler->up;
+		
+		const float *row = resampler->filter + (size_t)phase * taps;
+		for (uint32_t chan = 0; chan < channels; chan++) {
+			const float *samples = resampler->buffer + (size_t)chan * resampler->capacity + start;
+			store_output(out++, dot_product_func(row, samples, taps));
+		}
+		resampler->time += resampler->down;
+	}
+	
+	/* Drop the input samples that no later output sample depends on */
+	uint32_t consumed = resampler->time / resampler->up;
+	for (uint32_t chan = 0; chan < channels; chan++) {
+		float *buffer = resampler->buffer + (size_t)chan * resampler->capacity;
+		memmove(buffer, buffer + consumed, (resampler->length - consumed) * sizeof(float));
+	}
+	resampler->length -= consumed;
+	resampler->time -= (uint64_t)consumed * resampler->up;
+	
+	resampler->outputs += count;
+	return out;
+}
+
+/* Appends frames to the planar buffer, or zeros if in is NULL */
+static void append(Resampler *resampler, const int16_t *in, size_t frames) {
+	uint32_t channels = resampler->channels;
+	for (uint32_t chan = 0; chan < channels; chan++) {
+		float *buffer = resampler->buffer + (size_t)chan * resampler->capacity + resampler->length;
+		if (in) {
+			for (size_t i = 0; i < frames; i++) {
+				buffer[i] = in[i * channels + chan];
+			}
+		}
+		else {
+			memset(buffer, 0, frames * sizeof(float));
+		}
+	}
+	resampler->length += frames;
+}
+
+template <class T>
+static void resample_tmpl(Resampler *resampler, T *out, const int16_t *in, size_t frames) {
+	resampler->inputs += frames;
+	while (frames) {
+		size_t chunk = std::min<size_t>(frames, resampler->capacity - resampler->length);
+		append(resampler, in, chunk);
+		out = produce(resampler, out, get_output_count(resampler, resampler->length));
+		
+		in += chunk * resampler->channels;
+		frames -= chunk;
+	}
+}
+
+template <class T>
+static void flush_tmpl(Resampler *resampler, T *out) {
+	/* Half a filter of silence completes the filter windows of the remaining output samples */
+	size_t pending = get_flush_count(resampler);
+	size_t padding = resampler->taps / 2;
+	while (padding) {
+		size_t chunk = std::min<size_t>(padding, resampler->capacity - resampler->length);
+		append(resampler, NULL, chunk);
+		padding -= chunk;
+		
+		size_t count = std::min(pending, get_output_count(resampler, resampler->length));
+		out = produce(resampler, out, count);
+		pending -= count;
+	}
+	reset_resampler(resampler);
+}
+
+void resample(Resampler *resampler, int16_t *out, const int16_t *in, size_t frames) {
+	resample_tmpl(resampler, out, in, frames);
+}
+
+void resample(Resampler *resampler, float *out, const int16_t *in, size_t frames) {
+	resample_tmpl(resampler, out, in, frames);
+}
+
+void flush_resampler(Resampler *resampler, int16_t *out) {
+	flush_tmpl(resampler, out);
+}
+
+void flush_resampler(Resampler *resampler, float *out) {
+	flush_tmpl(resampler, out);
+}
+
+}
@@ -0,0 +1,47 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+/* A polyphase resampler with a Kaiser-windowed sinc filter. The filter
+ * table holds one row of taps for every phase of the rate ratio. The
+ * input is kept in planar float buffers, one per channel. */
+struct Resampler {
+	uint32_t channels;
+	uint32_t up;
+	uint32_t down;
+	uint32_t phases;
+	uint32_t taps;
+	float *filter;
+	
+	float *buffer;
+	uint32_t capacity;
+	uint32_t length;
+	
+	/* Position of the next output sample in the buffer, in units of 1/up input samples */
+	uint64_t time;
+	uint64_t inputs;
+	uint64_t outputs;
+};
+
+bool init_resampler(Resampler *resampler, uint32_t inRate, uint32_t outRate, uint32_t channels);
+void free_resampler(Resampler *resampler);
+void reset_resampler(Resampler *resampler);
+
+/* The number of output frames that resample produces for the given number of input frames */
+size_t get_resample_count(const Resampler *resampler, size_t frames);
+
+/* The number of output frames that are still pending at the end of the stream */
+size_t get_flush_count(const Resampler *resampler);
+
+/* Both functions take and produce interleaved frames. flush_resampler
+ * writes the pending output frames and resets the resampler. */
+void resample(Resampler *resampler, int16_t *out, const int16_t *in, size_t frames);
+void resample(Resampler *resampler, float *out, const int16_t *in, size_t frames);
+void flush_resampler(Resampler *resampler, int16_t *out);
+void flush_resampler(Resampler *resampler, float *out);
+
+}
@@ -0,0 +1,21 @@
+
+#pragma once
+
+#include <cstdint>
+
+namespace audio {
+
+/* Decoders write PCM-16 samples, or float samples normalized to [-1, 1) */
+inline void store_sample(int16_t *out, int16_t sample) {
+	*out = sample;
+}
+
+inline void store_sample(float *out, int16_t sample) {
+	*out = sample * (1.0f / 32768);
+}
+
+inline int16_t swap_sample(int16_t sample) {
+	return (int16_t)(((uint16_t)sample >> 8) | ((uint16_t)sample << 8));
+}
+
+}
@@ -0,0 +1,368 @@
+
+#include "audio/stream.h"
+#include "audio/sample.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace audio {
+
+struct FileReader {
+	const uint8_t *data;
+	size_t size;
+	bool bigEndian;
+	
+	bool contains(size_t offset, size_t length) const {
+		return offset <= size && length <= size - offset;
+	}
+	
+	uint8_t u8(size_t offset) const {
+		return data[offset];
+	}
+	
+	uint16_t u16(size_t offset) const {
+		const uint8_t *p = data + offset;
+		return bigEndian ? (p[0] << 8) | p[1] : p[0] | (p[1] << 8);
+	}
+	
+	uint32_t u32(size_t offset) const {
+		const uint8_t *p = data + offset;
+		if (bigEndian) {
+			return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+		}
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+};
+
+/* Reads the coefficients and the initial predictor/scale and history of a DSP-ADPCM channel */
+static void read_adpcm_info(ADPCMContext *ctx, const FileReader &file, size_t coefs, size_t state) {
+	for (int i = 0; i < 16; i++) {
+		ctx->coefs[i] = file.u16(coefs + i * 2);
+	}
+	ctx->header = file.u16(state);
+	ctx->hist1 = file.u16(state + 2);
+	ctx->hist2 = file.u16(state + 4);
+}
+
+static bool alloc_contexts(StreamInfo *info) {
+	info->contexts = (ADPCMContext *)calloc(info->channels, sizeof(ADPCMContext));
+	return info->contexts != NULL;
+}
+
+/* Reads the stream info that BFSTM, BCSTM and BRSTM files share, starting at the codec */
+static void read_stream_info(StreamInfo *info, const FileReader &file, size_t offset) {
+	info->codec = (StreamCodec)file.u8(offset);
+	info->loop = file.u8(offset + 1) != 0;
+	info->channels = file.u8(offset + 2);
+}
+
+/* BFSTM (Wii U, Switch) and BCSTM (3DS) */
+static StreamError parse_cstm(StreamInfo *info, const FileReader &file) {
+	if (!file.contains(0, 0x14)) return StreamError::InvalidFile;
+	
+	uint32_t sections = file.u16(0x10);
+	if (!file.contains(0x14, sections * 12)) return StreamError::InvalidFile;
+	
+	size_t infoOffset = 0, seekOffset = 0, dataOffset = 0;
+	size_t seekSize = 0;
+	for (uint32_t i = 0; i < sections; i++) {
+		size_t entry = 0x14 + i * 12;
+		uint16_t id = file.u16(entry);
+		size_t offset = file.u32(entry + 4);
+		size_t size = file.u32(entry + 8);
+		if (offset == 0xFFFFFFFF) continue;
+		if (!file.contains(offset, size) || size < 8) return StreamError::InvalidFile;
+		
+		if (id == 0x4000) infoOffset = offset;
+		else if (id == 0x4001) {
+			seekOffset = offset;
+			seekSize = size;
+		}
+		else if (id == 0x4002) dataOffset = offset;
+	}
+	
+	if (!infoOffset || !dataOffset) return StreamError::InvalidFile;
+	if (!file.contains(infoOffset, 0x20)) return StreamError::InvalidFile;
+	
+	/* References in the INFO block are relative to its body */
+	size_t base = infoOffset + 8;
+	size_t stream = base + file.u32(infoOffset + 0x0C);
+	size_t table = base + file.u32(infoOffset + 0x1C);
+	if (!file.contains(stream, 0x38)) return StreamError::InvalidFile;
+	
+	read_stream_info(info, file, stream);
+	info->sampleRate = file.u32(stream + 0x04);
+	info->loopStart = file.u32(stream + 0x08);
+	info->samples = file.u32(stream + 0x0C);
+	info->blockCount = file.u32(stream + 0x10);
+	info->blockSize = file.u32(stream + 0x14);
+	info->blockSamples = file.u32(stream + 0x18);
+	info->lastBlockSamples = file.u32(stream + 0x20);
+	info->lastBlockPaddedSize = file.u32(stream + 0x24);
+	info->seekInterval = file.u32(stream + 0x2C);
+	info->dataOffset = dataOffset + 8 + file.u32(stream + 0x34);
+	
+	if (seekOffset) {
+		info->seekOffset = seekOffset + 8;
+		info->seekEntries = (seekSize - 8) / std::max<uint32_t>(info->channels * 4, 1);
+	}
+	
+	if (info->codec == StreamCodec::ADPCM) {
+		if (!file.contains(table, 4 + info->channels * 8)) return StreamError::InvalidFile;
+		if (file.u32(table) < info->channels) return StreamError::InvalidFile;
+		if (!alloc_contexts(info)) return StreamError::NoMemory;
+		
+		for (uint32_t i = 0; i < info->channels; i++) {
+			size_t channel = table + file.u32(table + 8 + i * 8);
+			if (!file.contains(channel, 8)) return StreamError::InvalidFile;
+			
+			size_t adpcm = channel + file.u32(channel + 4);
+			if (!file.contains(adpcm, 0x26)) return StreamError::InvalidFile;
+			read_adpcm_info(&info->contexts[i], file, adpcm, adpcm + 0x20);
+		}
+	}
+	return StreamError::OK;
+}
+
+/* BRSTM (Wii) */
+static StreamError parse_rstm(StreamInfo *info, const FileReader &file) {
+	if (!file.contains(0, 0x28)) return StreamError::InvalidFile;
+	
+	size_t headOffset = file.u32(0x10);
+	size_t seekOffset = file.u32(0x18);
+	size_t seekSize = file.u32(0x1C);
+	if (!file.contains(headOffset, 0x20)) return StreamError::InvalidFile;
+	
+	/* References in the HEAD chunk are relative to its body */
+	size_t base = headOffset + 8;
+	size_t stream = base + file.u32(headOffset + 0x0C);
+	size_t table = base + file.u32(headOffset + 0x1C);
+	if (!file.contains(stream, 0x34)) return StreamError::InvalidFile;
+	
+	read_stream_info(info, file, stream);
+	info->sampleRate = file.u16(stream + 0x04);
+	info->loopStart = file.u32(stream + 0x08);
+	info->samples = file.u32(stream + 0x0C);
+	info->dataOffset = file.u32(stream + 0x10);
+	info->blockCount = file.u32(stream + 0x14);
+	info->blockSize = file.u32(stream + 0x18);
+	info->blockSamples = file.u32(stream + 0x1C);
+	info->lastBlockSamples = file.u32(stream + 0x24);
+	info->lastBlockPaddedSize = file.u32(stream + 0x28);
+	info->seekInterval = file.u32(stream + 0x2C);
+	
+	if (seekOffset && seekSize >= 8 && file.contains(seekOffset, seekSize)) {
+		info->seekOffset = seekOffset + 8;
+		info->seekEntries = (seekSize - 8) / std::max<uint32_t>(info->channels * 4, 1);
+	}
+	
+	if (info->codec == StreamCodec::ADPCM) {
+		if (!file.contains(table, 4 + info->channels * 8)) return StreamError::InvalidFile;
+		if (file.u8(table) < info->channels) return StreamError::InvalidFile;
+		if (!alloc_contexts(info)) return StreamError::NoMemory;
+		
+		for (uint32_t i = 0; i < info->channels; i++) {
+			size_t channel = base + file.u32(table + 8 + i * 8);
+			if (!file.contains(channel, 8)) return StreamError::InvalidFile;
+			
+			/* The ADPCM info starts with a gain field that the other formats do not have */
+			size_t adpcm = base + file.u32(channel + 4);
+			if (!file.contains(adpcm, 0x28)) return StreamError::InvalidFile;
+			read_adpcm_info(&info->contexts[i], file, adpcm, adpcm + 0x22);
+		}
+	}
+	return StreamError::OK;
+}
+
+static size_t get_encoded_size(StreamCodec codec, size_t samples) {
+	if (codec == StreamCodec::PCM8) return samples;
+	if (codec == StreamCodec::PCM16) return samples * 2;
+	return get_adpcm_size(samples);
+}
+
+/* Checks that every block of every channel lies within the file */
+static bool check_layout(const StreamInfo *info) {
+	if (!info->channels) return false;
+	if (!info->samples) return true;
+	
+	if (!info->blockCount || !info->blockSamples) return false;
+	if (info->codec == StreamCodec::ADPCM && info->blockSamples % 14) return false;
+	if (info->lastBlockSamples > info->blockSamples) return false;
+	
+	uint64_t covered = (uint64_t)(info->blockCount - 1) * info->blockSamples + info->lastBlockSamples;
+	if (covered < info->samples) return false;
+	
+	if (get_encoded_size(info->codec, info->blockSamples) > info->blockSize) return false;
+	size_t lastSize = get_encoded_size(info->codec, info->lastBlockSamples);
+	if (lastSize > info->lastBlockPaddedSize) return false;
+	
+	if (info->dataOffset > info->fileSize) return false;
+	size_t available = info->fileSize - info->dataOffset;
+	
+	uint64_t stride = (uint64_t)info->blockSize * info->channels;
+	if (info->blockCount > 1 && stride > available / (info->blockCount - 1)) return false;
+	
+	uint64_t end = stride * (info->blockCount - 1);
+	end += (uint64_t)info->lastBlockPaddedSize * (info->channels - 1) + lastSize;
+	return end <= available;
+}
+
+StreamError parse_stream(StreamInfo *info, const uint8_t *file, size_t size) {
+	memset(info, 0, sizeof(StreamInfo));
+	if (size < 6) return StreamError::InvalidFile;
+	
+	FileReader reader;
+	reader.data = file;
+	reader.size = size;
+	
+	/* The byte order mark tells the endianness of every other field */
+	if (file[4] == 0xFE && file[5] == 0xFF) reader.bigEndian = true;
+	else if (file[4] == 0xFF && file[5] == 0xFE) reader.bigEndian = false;
+	else return StreamError::InvalidFile;
+	
+	info->file = file;
+	info->fileSize = size;
+	info->bigEndian = reader.bigEndian;
+	
+	StreamError error;
+	if (!memcmp(file, "FSTM", 4) || !memcmp(file, "CSTM", 4)) {
+		error = parse_cstm(info, reader);
+	}
+	else if (!memcmp(file, "RSTM", 4)) {
+		error = parse_rstm(info, reader);
+	}
+	else {
+		error = StreamError::InvalidFile;
+	}
+	
+	if (error == StreamError::OK) {
+		if ((int)info->codec > (int)StreamCodec::ADPCM) {
+			error = StreamError::UnsupportedCodec;
+		}
+		else if (!check_layout(info)) {
+			error = StreamError::InvalidFile;
+		}
+	}
+	
+	/* Seek entries are only useful if they start at frame boundaries */
+	if (!info->seekInterval || info->seekInterval % 14) {
+		info->seekEntries = 0;
+	}
+	
+	if (error != StreamError::OK) {
+		free_stream(info);
+	}
+	return error;
+}
+
+void free_stream(StreamInfo *info) {
+	free(info->contexts);
+	info->contexts = NULL;
+}
+
+static const uint8_t *get_block(const StreamInfo *info, uint32_t block, uint32_t channel) {
+	size_t offset = info->dataOffset + (size_t)block * info->blockSize * info->channels;
+	if (block == info->blockCount - 1) {
+		offset += (size_t)channel * info->lastBlockPaddedSize;
+	}
+	else {
+		offset += (size_t)channel * info->blockSize;
+	}
+	return info->file + offset;
+}
+
+template <class T>
+static StreamError read_stream_tmpl(T *out, const StreamInfo *info, uint32_t start, uint32_t count) {
+	if (start > info->samples || count > info->samples - start) {
+		return StreamError::OutOfRange;
+	}
+	if (!count) return StreamError::OK;
+	
+	uint32_t channels = info->channels;
+	uint32_t pos = start;
+	uint32_t end = start + count;
+	
+	int16_t *scratch = NULL;
+	ADPCMContext *contexts = NULL;
+	if (info->codec == StreamCodec::ADPCM) {
+		scratch = (int16_t *)malloc(info->blockSamples * 2);
+		contexts = (ADPCMContext *)malloc(channels * sizeof(ADPCMContext));
+		if (!scratch || !contexts) {
+			free(scratch);
+			free(contexts);
+			return StreamError::NoMemory;
+		}
+		
+		memcpy(contexts, info->contexts, channels * sizeof(ADPCMContext));
+		
+		/* Without a seek table the history is only known at the start of the stream */
+		pos = 0;
+		if (info->seekEntries) {
+			uint32_t index = std::min(start / info->seekInterval, info->seekEntries - 1);
+			pos = index * info->seekInterval;
+			
+			FileReader reader = {info->file, info->fileSize, info->bigEndian};
+			size_t entry = info->seekOffset + (size_t)index * channels * 4;
+			for (uint32_t i = 0; i < channels; i++) {
+				contexts[i].hist1 = reader.u16(entry + i * 4);
+				contexts[i].hist2 = reader.u16(entry + i * 4 + 2);
+			}
+		}
+	}
+	
+	StreamError error = StreamError::OK;
+	while (pos < end) {
+		uint32_t block = pos / info->blockSamples;
+		uint32_t offset = pos - block * info->blockSamples;
+		uint32_t num = std::min(end - pos, info->blockSamples - offset);
+		
+		/* Samples in front of the requested range only advance the decoder */
+		uint32_t skip = pos < start ? std::min(start - pos, num) : 0;
+		T *dest = out + (size_t)(pos + skip - start) * channels;
+		
+		for (uint32_t i = 0; i < channels; i++) {
+			const uint8_t *data = get_block(info, block, i);
+			if (info->codec == StreamCodec::PCM8) {
+				for (uint32_t j = 0; j < num; j++) {
+					store_sample(&dest[j * channels + i], (int8_t)data[offset + j] << 8);
+				}
+			}
+			else if (info->codec == StreamCodec::PCM16) {
+				const uint8_t *in = data + offset * 2;
+				for (uint32_t j = 0; j < num; j++) {
+					uint16_t sample = info->bigEndian ?
+						(in[j * 2] << 8) | in[j * 2 + 1] :
+						in[j * 2] | (in[j * 2 + 1] << 8);
+					store_sample(&dest[j * channels + i], sample);
+				}
+			}
+			else {
+				if (!decode_adpcm(scratch, data + offset / 14 * 8, num, &contexts[i])) {
+					error = StreamError::InvalidCoefs;
+					break;
+				}
+				for (uint32_t j = skip; j < num; j++) {
+					store_sample(&dest[(j - skip) * channels + i], scratch[j]);
+				}
+			}
+		}
+		
+		if (error != StreamError::OK) break;
+		pos += num;
+	}
+	
+	free(scratch);
+	free(contexts);
+	return error;
+}
+
+StreamError read_stream(int16_t *out, const StreamInfo *info, uint32_t start, uint32_t count) {
+	return read_stream_tmpl(out, info, start, count);
+}
+
+StreamError read_stream(float *out, const StreamInfo *info, uint32_t start, uint32_t count) {
+	return read_stream_tmpl(out, info, start, count);
+}
+
+}
@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include "audio/adpcm.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio {
+
+enum class StreamCodec {
+	PCM8 = 0,
+	PCM16 = 1,
+	ADPCM = 2
+};
+
+enum class StreamError {
+	OK,
+	InvalidFile,
+	UnsupportedCodec,
+	OutOfRange,
+	InvalidCoefs,
+	NoMemory
+};
+
+/* Describes a BFSTM, BCSTM or BRSTM file. The sample data is not copied,
+ * so the file must outlive the stream info. */
+struct StreamInfo {
+	const uint8_t *file;
+	size_t fileSize;
+	bool bigEndian;
+	
+	StreamCodec codec;
+	bool loop;
+	uint32_t channels;
+	uint32_t sampleRate;
+	uint32_t loopStart;
+	uint32_t samples;
+	
+	uint32_t blockCount;
+	uint32_t blockSize;
+	uint32_t blockSamples;
+	uint32_t lastBlockSamples;
+	uint32_t lastBlockPaddedSize;
+	size_t dataOffset;
+	
+	/* The seek table holds the history samples of every channel at every multiple of seekInterval */
+	uint32_t seekInterval;
+	uint32_t seekEntries;
+	size_t seekOffset;
+	
+	/* Coefficients and initial history of every channel (ADPCM only) */
+	ADPCMContext *contexts;
+};
+
+StreamError parse_stream(StreamInfo *info, const uint8_t *file, size_t size);
+void free_stream(StreamInfo *info);
+
+/* Decodes count samples starting at sample start into interleaved PCM16 or float samples.
+ * Only the blocks that overlap the requested range are decoded. */
+StreamError read_stream(int16_t *out, const StreamInfo *info, uint32_t start, uint32_t count);
+StreamError read_stream(float *out, const StreamInfo *info, uint32_t start, uint32_t count);
+
+}
@@ -7,39 +7,87 @@
 #include <cstring>
 
 #include "dsptool/encoder.h"
+#include "parallel.h"
+#include "simd.h"
 
 namespace dsptool {
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
+#define FRAMES_PER_CHUNK 1024
+#define DRAFT_FRAME_STEP 4
+
 /* Temporal Vector
 * A contiguous history of 3 samples starting with
 * 'current' and going 2 backwards
 */
 typedef double tvec[3];
 
+typedef void (*EncodeFrameFunc)(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2]);
+
 void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2]);
+void DSPEncodeFrameDraft(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2]);
+EncodeFrameFunc GetEncodeFrameFunc();
+
+void encode(const int16_t* src, uint8_t* dst, ADPCMINFO* cxt, uint32_t samples, uint32_t maxRecords, uint32_t loopStart, bool draft, ENCODESTATS* stats)
+{
+	correlateCoefs(src, samples, cxt->coef, maxRecords, draft);
+
+	cxt->yn1 = 0;
+	cxt->yn2 = 0;
+	encodeFrames(src, dst, cxt, samples, loopStart, draft, stats);
+}
 
-void encode(const int16_t* src, uint8_t* dst, ADPCMINFO* cxt, uint32_t samples)
+void encodeFrames(const int16_t* src, uint8_t* dst, ADPCMINFO* cxt, uint32_t samples, uint32_t loopStart, bool draft, ENCODESTATS* stats)
 {
 	int16_t* coefs = cxt->coef;
-	correlateCoefs(src, samples, coefs);
 
 	int32_t frameCount = samples / SAMPLES_PER_FRAME + (samples % SAMPLES_PER_FRAME != 0);
 
 	const int16_t* pcm = src;
 	uint8_t* adpcm = dst;
-	int16_t pcmFrame[SAMPLES_PER_FRAME + 2] = { 0 };
+	int16_t pcmFrame[SAMPLES_PER_FRAME + 2] = { cxt->yn2, cxt->yn1 };
 	uint8_t adpcmFrame[BYTES_PER_FRAME] = { 0 };
 
+	cxt->loop_pred_scale = 0;
+	cxt->loop_yn1 = 0;
+	cxt->loop_yn2 = 0;
+
+	uint64_t sse = 0;
+	uint64_t energy = 0;
+	uint32_t peak = 0;
+
+	EncodeFrameFunc encodeFrame = draft ? DSPEncodeFrameDraft : GetEncodeFrameFunc();
+
 	for (int i = 0; i < frameCount; ++i, pcm += SAMPLES_PER_FRAME, adpcm += BYTES_PER_FRAME)
 	{
 		int32_t sampleCount = MIN(samples - i * SAMPLES_PER_FRAME, SAMPLES_PER_FRAME);
 		memset(pcmFrame + 2, 0, SAMPLES_PER_FRAME * sizeof(int16_t));
 		memcpy(pcmFrame + 2, pcm, sampleCount * sizeof(int16_t));
 
-		DSPEncodeFrame(pcmFrame, SAMPLES_PER_FRAME, adpcmFrame, (short(*)[2])&coefs[0]);
+		encodeFrame(pcmFrame, SAMPLES_PER_FRAME, adpcmFrame, (short(*)[2])&coefs[0]);
+
+		/* pcmFrame now holds the decoded samples, preceded by the two history samples */
+		if ((uint32_t)i == loopStart / SAMPLES_PER_FRAME)
+		{
+			int offset = loopStart % SAMPLES_PER_FRAME;
+			cxt->loop_pred_scale = adpcmFrame[0];
+			cxt->loop_yn1 = pcmFrame[offset + 1];
+			cxt->loop_yn2 = pcmFrame[offset];
+		}
+
+		/* The padding at the end of the last frame is not part of the stream */
+		if (stats)
+		{
+			for (int s = 0; s < sampleCount; s++)
+			{
+				int error = pcm[s] - pcmFrame[s + 2];
+				sse += (int64_t)error * error;
+				energy += (int64_t)pcm[s] * pcm[s];
+				peak = MAX(peak, (uint32_t)abs(error));
+			}
+		}
 
 		pcmFrame[0] = pcmFrame[14];
 		pcmFrame[1] = pcmFrame[15];
@@ -49,8 +97,13 @@ void encode(const int16_t* src, uint8_t* dst, ADPCMINFO* cxt, uint32_t samples)
 
 	cxt->gain = 0;
 	cxt->pred_scale = *dst;
-	cxt->yn1 = 0;
-	cxt->yn2 = 0;
+
+	if (stats)
+	{
+		stats->sse = sse;
+		stats->energy = energy;
+		stats->peak = peak;
+	}
 }
 
 void InnerProductMerge(tvec vecOut, short pcmBuf[14])
@@ -278,7 +331,7 @@ double ContrastVectors(tvec source1, tvec source2)
 	return val1 + (2.0 * val * val2) + (2.0 * (-source2[1] * val + -source2[2]) * val3);
 }
 
-void FilterRecords(tvec vecBest[8], int exp, tvec records[], int recordCount)
+void FilterRecords(tvec vecBest[8], int exp, tvec records[], int recordCount, int passes)
 {
 	tvec bufferList[8];
 
@@ -288,7 +341,7 @@ void FilterRecords(tvec vecBest[8], int exp, tvec records[], int recordCount)
 	int index;
 	double value, tempVal = 0;
 
-	for (int x = 0; x < 2; x++)
+	for (int x = 0; x < passes; x++)
 	{
 		for (int y = 0; y < exp; y++)
 		{
@@ -325,83 +378,150 @@ void FilterRecords(tvec vecBest[8], int exp, tvec records[], int recordCount)
 	}
 }
 
-void correlateCoefs(const int16_t* source, uint32_t samples, int16_t* coefsOut)
+/* Copies a frame of the zero-padded source stream */
+void ReadFrame(short pcmOut[14], const int16_t* source, uint32_t samples, int frame)
 {
-	int numFrames = (samples + 13) / 14;
-	int frameSamples;
+	int64_t start = (int64_t)frame * 14;
+	for (int z = 0; z < 14; z++)
+	{
+		int64_t index = start + z;
+		pcmOut[z] = (index >= 0 && index < samples) ? source[index] : 0;
+	}
+}
 
-	short* blockBuffer = (short*)calloc(sizeof(short), 0x3800);
-	short pcmHistBuffer[2][14] = { 0 };
+/* Appends the records of every step-th frame in [firstFrame, lastFrame) to records */
+int AnalyzeFrames(const int16_t* source, uint32_t samples, int firstFrame, int lastFrame, tvec* records, int step)
+{
+	short pcmHistBuffer[2][14];
 
 	tvec vec1;
-	tvec vec2;
-
 	tvec mtx[3];
 	int vecIdxs[3];
 
-	tvec* records = (tvec*)calloc(sizeof(tvec), numFrames * 2);
 	int recordCount = 0;
 
-	tvec vecBest[8];
-
-	/* Iterate though 1024-block frames */
-	for (int x = samples; x > 0;)
+	/* Every frame is analyzed together with the frame before it */
+	ReadFrame(pcmHistBuffer[1], source, samples, firstFrame - 1);
+	for (int frame = firstFrame; frame < lastFrame; frame += step)
 	{
-		if (x > 0x3800) /* Full 1024-block frame */
-		{
-			frameSamples = 0x3800;
-			x -= 0x3800;
-		}
-		else /* Partial frame */
-		{
-			/* Zero lingering block samples */
-			frameSamples = x;
-			for (int z = 0; z < 14 && z + frameSamples < 0x3800; z++)
-				blockBuffer[frameSamples + z] = 0;
-			x = 0;
-		}
-
-		/* Copy (potentially non-frame-aligned PCM samples into aligned buffer) */
-		memcpy(blockBuffer, source, frameSamples * sizeof(short));
-		source += frameSamples;
-
+		if (step == 1)
+			memcpy(pcmHistBuffer[0], pcmHistBuffer[1], sizeof(pcmHistBuffer[1]));
+		else
+			ReadFrame(pcmHistBuffer[0], source, samples, frame - 1);
+		ReadFrame(pcmHistBuffer[1], source, samples, frame);
 
-		for (int i = 0; i < frameSamples;)
+		InnerProductMerge(vec1, pcmHistBuffer[1]);
+		if (fabs(vec1[0]) > 10.0)
 		{
-			for (int z = 0; z < 14; z++)
-				pcmHistBuffer[0][z] = pcmHistBuffer[1][z];
-			for (int z = 0; z < 14; z++)
-				pcmHistBuffer[1][z] = blockBuffer[i++];
-
-			InnerProductMerge(vec1, pcmHistBuffer[1]);
-			if (fabs(vec1[0]) > 10.0)
+			OuterProductMerge(mtx, pcmHistBuffer[1]);
+			if (!AnalyzeRanges(mtx, vecIdxs))
 			{
-				OuterProductMerge(mtx, pcmHistBuffer[1]);
-				if (!AnalyzeRanges(mtx, vecIdxs))
+				BidirectionalFilter(mtx, vecIdxs, vec1);
+				if (!QuadraticMerge(vec1))
 				{
-					BidirectionalFilter(mtx, vecIdxs, vec1);
-					if (!QuadraticMerge(vec1))
-					{
-						FinishRecord(vec1, records[recordCount]);
-						recordCount++;
-					}
+					FinishRecord(vec1, records[recordCount]);
+					recordCount++;
 				}
 			}
 		}
 	}
+	return recordCount;
+}
+
+/* Collects the records of frames [firstFrame, lastFrame) in stream order */
+int CollectRecords(const int16_t* source, uint32_t samples, int firstFrame, int lastFrame, tvec* records, int step)
+{
+	/* Analyze 1024-frame chunks in parallel; every chunk writes its records
+	* to its own part of the array, which keeps them in stream order */
+	int numFrames = lastFrame - firstFrame;
+	int numChunks = (numFrames + FRAMES_PER_CHUNK - 1) / FRAMES_PER_CHUNK;
+	int* chunkRecords = (int*)calloc(sizeof(int), numChunks);
+
+	parallel_for(numChunks, [&](size_t chunk) {
+		int chunkStart = chunk * FRAMES_PER_CHUNK;
+		int chunkEnd = MIN(chunkStart + FRAMES_PER_CHUNK, numFrames);
+		chunkRecords[chunk] = AnalyzeFrames(source, samples, firstFrame + chunkStart, firstFrame + chunkEnd, &records[chunkStart], step);
+	});
+
+	int recordCount = 0;
+	for (int chunk = 0; chunk < numChunks; chunk++)
+	{
+		memmove(&records[recordCount], &records[chunk * FRAMES_PER_CHUNK], chunkRecords[chunk] * sizeof(tvec));
+		recordCount += chunkRecords[chunk];
+	}
+
+	free(chunkRecords);
+	return recordCount;
+}
+
+/* If maxRecords is nonzero, at most maxRecords records are kept in memory. They are
+* a uniform sample of the stream, chosen by reservoir sampling with a fixed seed, and
+* the frames are analyzed in windows. The mean record is still computed over every record.
+* In draft mode only every DRAFT_FRAME_STEP-th frame of long streams is analyzed and
+* the records are filtered once per round instead of twice. */
+void correlateCoefs(const int16_t* source, uint32_t samples, int16_t* coefsOut, uint32_t maxRecords, bool draft)
+{
+	int numFrames = (samples + 13) / 14;
+
+	tvec vec1;
+	tvec vec2;
+
+	bool bounded = maxRecords && (uint32_t)numFrames > maxRecords;
+
+	/* Short streams are always analyzed completely */
+	int step = (draft && numFrames > FRAMES_PER_CHUNK) ? DRAFT_FRAME_STEP : 1;
+
+	/* A frame produces at most one record */
+	int windowFrames = numFrames;
+	int capacity = numFrames;
+	if (bounded)
+	{
+		size_t minFrames = FRAMES_PER_CHUNK * default_thread_count();
+		windowFrames = MIN(numFrames, (int)((MAX(maxRecords, minFrames) + FRAMES_PER_CHUNK - 1) / FRAMES_PER_CHUNK * FRAMES_PER_CHUNK));
+		capacity = maxRecords;
+	}
+
+	tvec* records = (tvec*)calloc(sizeof(tvec), capacity);
+	tvec* window = bounded ? (tvec*)calloc(sizeof(tvec), windowFrames) : records;
+	int recordCount = 0;
+
+	tvec vecBest[8];
 
 	vec1[0] = 1.0;
 	vec1[1] = 0.0;
 	vec1[2] = 0.0;
 
-	for (int z = 0; z < recordCount; z++)
+	uint64_t totalRecords = 0;
+	uint64_t random = 1;
+	for (int firstFrame = 0; firstFrame < numFrames; firstFrame += windowFrames)
 	{
-		MatrixFilter(records[z], vecBest[0]);
-		for (int y = 1; y <= 2; y++)
-			vec1[y] += vecBest[0][y];
+		int lastFrame = MIN(firstFrame + windowFrames, numFrames);
+		int windowRecords = CollectRecords(source, samples, firstFrame, lastFrame, window, step);
+
+		for (int z = 0; z < windowRecords; z++)
+		{
+			MatrixFilter(window[z], vecBest[0]);
+			for (int y = 1; y <= 2; y++)
+				vec1[y] += vecBest[0][y];
+
+			if (bounded)
+			{
+				uint64_t index = totalRecords;
+				if (totalRecords >= maxRecords)
+				{
+					random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+					index = (random >> 32) % (totalRecords + 1);
+				}
+				if (index < maxRecords)
+					memcpy(records[index], window[z], sizeof(tvec));
+			}
+			totalRecords++;
+		}
 	}
+	recordCount = MIN(totalRecords, (uint64_t)capacity);
+
 	for (int y = 1; y <= 2; y++)
-		vec1[y] /= recordCount;
+		vec1[y] /= totalRecords;
 
 	MergeFinishRecord(vec1, vecBest[0]);
 
@@ -417,7 +537,7 @@ void correlateCoefs(const int16_t* source, uint32_t samples, int16_t* coefsOut)
 				vecBest[exp + i][y] = (0.01 * vec2[y]) + vecBest[i][y];
 		++w;
 		exp = 1 << w;
-		FilterRecords(vecBest, exp, records, recordCount);
+		FilterRecords(vecBest, exp, records, recordCount, draft ? 1 : 2);
 	}
 
 	/* Write output */
@@ -438,8 +558,20 @@ void correlateCoefs(const int16_t* source, uint32_t samples, int16_t* coefsOut)
 	}
 
 	/* Free memory */
+	if (bounded)
+		free(window);
 	free(records);
-	free(blockBuffer);
+}
+
+/* Computes (int)((double)value / (1 << shift) +/- 0.4999999f) exactly with
+* integer arithmetic, which is valid for shifts up to 23 */
+static inline int RoundScaled(int value, int shift)
+{
+	/* Rounds the magnitude without branching on the sign */
+	unsigned bias = (1u << (shift - 1)) - 1;
+	unsigned sign = (unsigned)(value >> 31);
+	unsigned magnitude = ((unsigned)value ^ sign) - sign;
+	return (int)((((magnitude + bias) >> shift) ^ sign) - sign);
 }
 
 /* Make sure source includes the yn values (16 samples total) */
@@ -497,7 +629,7 @@ void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[
 				/* Evaluate from real sample */
 				v2 = (pcmInOut[s + 2] << 11) - v1;
 				/* Round to nearest sample */
-				v3 = (v2 > 0) ? (int)((double)v2 / (1 << scale[i]) / 2048 + 0.4999999f) : (int)((double)v2 / (1 << scale[i]) / 2048 - 0.4999999f);
+				v3 = RoundScaled(v2, scale[i] + 11);
 
 				/* Clamp sample and set index */
 				if (v3 < -8)
@@ -559,6 +691,297 @@ void DSPEncodeFrame(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[
 	}
 }
 
+/* Draft quality version of DSPEncodeFrame. Only the coef set with the smallest
+* prediction error is evaluated, and the scale search starts one step higher
+* and stops after two passes. */
+void DSPEncodeFrameDraft(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2])
+{
+	int inSamples[16];
+	int outSamples[14];
+
+	/* Correlations of every sample with the previous two samples */
+	int64_t r22 = 0, r21 = 0, r20 = 0, r11 = 0, r10 = 0, r00 = 0;
+	for (int s = 0; s < sampleCount; s++)
+	{
+		int x0 = pcmInOut[s];
+		int x1 = pcmInOut[s + 1];
+		int x2 = pcmInOut[s + 2];
+		r22 += x2 * x2;
+		r21 += x2 * x1;
+		r20 += x2 * x0;
+		r11 += x1 * x1;
+		r10 += x1 * x0;
+		r00 += x0 * x0;
+	}
+
+	/* Pick the coef set that predicts the source samples best */
+	int bestIndex = 0;
+	double bestError = DBL_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		double a = coefsIn[i][0] / 2048.0;
+		double b = coefsIn[i][1] / 2048.0;
+		double error = r22 - 2 * a * r21 - 2 * b * r20 + a * a * r11 + 2 * a * b * r10 + b * b * r00;
+		if (error < bestError)
+		{
+			bestError = error;
+			bestIndex = i;
+		}
+	}
+
+	int coef1 = coefsIn[bestIndex][0];
+	int coef2 = coefsIn[bestIndex][1];
+
+	int distance = 0;
+	for (int s = 0; s < sampleCount; s++)
+	{
+		int v1 = ((pcmInOut[s] * coef2) + (pcmInOut[s + 1] * coef1)) / 2048;
+		int v2 = pcmInOut[s + 2] - v1;
+		int v3 = (v2 >= 32767) ? 32767 : (v2 <= -32768) ? -32768 : v2;
+		if (abs(v3) > abs(distance))
+			distance = v3;
+	}
+
+	inSamples[0] = pcmInOut[0];
+	inSamples[1] = pcmInOut[1];
+
+	/* Set initial scale */
+	int scale;
+	for (scale = 0; (scale <= 12) && ((distance > 7) || (distance < -8)); scale++, distance /= 2)
+	{
+	}
+	scale = (scale <= 0) ? -1 : scale - 1;
+
+	/* Stop before adjusting the scale on the last pass, so that it matches the output samples */
+	for (int pass = 1; ; pass++)
+	{
+		int index = 0;
+		scale++;
+
+		for (int s = 0; s < sampleCount; s++)
+		{
+			int v1 = (inSamples[s] * coef2) + (inSamples[s + 1] * coef1);
+			int v2 = (pcmInOut[s + 2] << 11) - v1;
+			int v3 = RoundScaled(v2, scale + 11);
+
+			/* Clamp sample and set index without branches */
+			index = MAX(index, MAX(-8 - v3, v3 - 7));
+			v3 = MIN(MAX(v3, -8), 7);
+
+			outSamples[s] = v3;
+
+			v1 = (v1 + ((v3 * (1 << scale)) << 11) + 1024) >> 11;
+			inSamples[s + 2] = (v1 >= 32767) ? 32767 : (v1 <= -32768) ? -32768 : v1;
+		}
+
+		if ((index <= 1) || (pass == 2))
+			break;
+
+		for (int x = index + 8; x > 256; x >>= 1)
+			if (++scale >= 12)
+				scale = 11;
+
+		if (scale >= 12)
+			break;
+	}
+
+	for (int s = 0; s < sampleCount; s++)
+		pcmInOut[s + 2] = inSamples[s + 2];
+
+	adpcmOut[0] = (char)((bestIndex << 4) | (scale & 0xF));
+
+	for (int s = sampleCount; s < 14; s++)
+		outSamples[s] = 0;
+
+	for (int y = 0; y < 7; y++)
+	{
+		adpcmOut[y + 1] = (char)((outSamples[y * 2] << 4) | (outSamples[y * 2 + 1] & 0xF));
+	}
+}
+
+#ifdef HAVE_AVX2
+/* Same as DSPEncodeFrame, but evaluates the 8 coef sets in the lanes of
+* AVX2 registers. The output is identical to DSPEncodeFrame. */
+TARGET_AVX2
+void DSPEncodeFrameAVX2(short pcmInOut[16], int sampleCount, unsigned char adpcmOut[8], const short coefsIn[8][2])
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+
+	__m256i coef1 = _mm256_setr_epi32(coefsIn[0][0], coefsIn[1][0], coefsIn[2][0], coefsIn[3][0],
+		coefsIn[4][0], coefsIn[5][0], coefsIn[6][0], coefsIn[7][0]);
+	__m256i coef2 = _mm256_setr_epi32(coefsIn[0][1], coefsIn[1][1], coefsIn[2][1], coefsIn[3][1],
+		coefsIn[4][1], coefsIn[5][1], coefsIn[6][1], coefsIn[7][1]);
+
+	__m256i pcm[16];
+	for (int s = 0; s < 16; s++)
+		pcm[s] = _mm256_set1_epi32(pcmInOut[s]);
+
+	/* Find the largest distance of the unquantized prediction */
+	__m256i distance = zero;
+	for (int s = 0; s < sampleCount; s++)
+	{
+		__m256i v1 = _mm256_add_epi32(_mm256_mullo_epi32(pcm[s], coef2), _mm256_mullo_epi32(pcm[s + 1], coef1));
+		v1 = _mm256_srai_epi32(_mm256_add_epi32(v1, _mm256_and_si256(_mm256_srai_epi32(v1, 31), _mm256_set1_epi32(2047))), 11);
+		__m256i v3 = _mm256_sub_epi32(pcm[s + 2], v1);
+		v3 = _mm256_min_epi32(_mm256_max_epi32(v3, _mm256_set1_epi32(-32768)), _mm256_set1_epi32(32767));
+		__m256i larger = _mm256_cmpgt_epi32(_mm256_abs_epi32(v3), _mm256_abs_epi32(distance));
+		distance = _mm256_blendv_epi8(distance, v3, larger);
+	}
+
+	/* Set initial scale */
+	__m256i scale = zero;
+	__m256i running = _mm256_set1_epi32(-1);
+	for (int i = 0; i <= 12; i++)
+	{
+		__m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(distance, _mm256_set1_epi32(7)),
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(-8), distance));
+		running = _mm256_and_si256(running, outside);
+		scale = _mm256_sub_epi32(scale, running);
+		__m256i halved = _mm256_srai_epi32(_mm256_add_epi32(distance, _mm256_srli_epi32(distance, 31)), 1);
+		distance = _mm256_blendv_epi8(distance, halved, running);
+	}
+	scale = _mm256_blendv_epi8(_mm256_sub_epi32(scale, _mm256_set1_epi32(2)), _mm256_set1_epi32(-1),
+		_mm256_cmpgt_epi32(_mm256_set1_epi32(2), scale));
+
+	__m256i inSamples[16];
+	__m256i outSamples[14];
+	__m256i curIn[16];
+	__m256i curOut[14];
+	__m256i distEven = zero;
+	__m256i distOdd = zero;
+
+	inSamples[0] = curIn[0] = pcm[0];
+	inSamples[1] = curIn[1] = pcm[1];
+	for (int s = 0; s < 14; s++)
+	{
+		inSamples[s + 2] = curIn[s + 2] = zero;
+		outSamples[s] = curOut[s] = zero;
+	}
+
+	__m256i active = _mm256_set1_epi32(-1);
+	do
+	{
+		scale = _mm256_sub_epi32(scale, active);
+
+		__m256i shift = _mm256_add_epi32(scale, _mm256_set1_epi32(11));
+		__m256i bias = _mm256_sub_epi32(_mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one)), one);
+		__m256i index = zero;
+		__m256i accumEven = zero;
+		__m256i accumOdd = zero;
+
+		for (int s = 0; s < sampleCount; s++)
+		{
+			/* Multiply previous */
+			__m256i v1 = _mm256_add_epi32(_mm256_mullo_epi32(curIn[s], coef2), _mm256_mullo_epi32(curIn[s + 1], coef1));
+			/* Evaluate from real sample */
+			__m256i v2 = _mm256_sub_epi32(_mm256_slli_epi32(pcm[s + 2], 11), v1);
+			/* Round to nearest sample (see RoundScaled) */
+			__m256i rounded = _mm256_srlv_epi32(_mm256_add_epi32(_mm256_abs_epi32(v2), bias), shift);
+			__m256i v3 = _mm256_blendv_epi8(_mm256_sub_epi32(zero, rounded), rounded, _mm256_cmpgt_epi32(v2, zero));
+
+			/* Clamp sample and set index */
+			index = _mm256_max_epi32(index, _mm256_sub_epi32(_mm256_set1_epi32(-8), v3));
+			index = _mm256_max_epi32(index, _mm256_sub_epi32(v3, _mm256_set1_epi32(7)));
+			v3 = _mm256_min_epi32(_mm256_max_epi32(v3, _mm256_set1_epi32(-8)), _mm256_set1_epi32(7));
+
+			/* Store result */
+			curOut[s] = v3;
+
+			/* Round and expand */
+			v1 = _mm256_add_epi32(_mm256_add_epi32(v1, _mm256_sllv_epi32(v3, shift)), _mm256_set1_epi32(1024));
+			v1 = _mm256_srai_epi32(v1, 11);
+			/* Clamp and store */
+			v2 = _mm256_min_epi32(_mm256_max_epi32(v1, _mm256_set1_epi32(-32768)), _mm256_set1_epi32(32767));
+			curIn[s + 2] = v2;
+			/* Accumulate distance */
+			v3 = _mm256_sub_epi32(pcm[s + 2], v2);
+			accumEven = _mm256_add_epi64(accumEven, _mm256_mul_epi32(v3, v3));
+			v3 = _mm256_srli_epi64(v3, 32);
+			accumOdd = _mm256_add_epi64(accumOdd, _mm256_mul_epi32(v3, v3));
+		}
+
+		/* Keep the results of the lanes that were still searching */
+		for (int s = 0; s < sampleCount; s++)
+		{
+			inSamples[s + 2] = _mm256_blendv_epi8(inSamples[s + 2], curIn[s + 2], active);
+			outSamples[s] = _mm256_blendv_epi8(outSamples[s], curOut[s], active);
+		}
+		distEven = _mm256_blendv_epi8(distEven, accumEven, _mm256_shuffle_epi32(active, 0xA0));
+		distOdd = _mm256_blendv_epi8(distOdd, accumOdd, _mm256_shuffle_epi32(active, 0xF5));
+
+		/* Increase the scale once for every halving of index + 8 above 256 */
+		__m256i steps = zero;
+		__m256i x = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+		__m256i above = _mm256_cmpgt_epi32(x, _mm256_set1_epi32(256));
+		while (!_mm256_testz_si256(above, above))
+		{
+			steps = _mm256_sub_epi32(steps, above);
+			x = _mm256_srli_epi32(x, 1);
+			above = _mm256_cmpgt_epi32(x, _mm256_set1_epi32(256));
+		}
+		__m256i adjusted = _mm256_min_epi32(_mm256_add_epi32(scale, steps), _mm256_set1_epi32(11));
+		adjusted = _mm256_blendv_epi8(scale, adjusted, _mm256_cmpgt_epi32(steps, zero));
+		scale = _mm256_blendv_epi8(scale, adjusted, active);
+
+		active = _mm256_and_si256(active, _mm256_cmpgt_epi32(_mm256_set1_epi32(12), scale));
+		active = _mm256_and_si256(active, _mm256_cmpgt_epi32(index, one));
+	} while (!_mm256_testz_si256(active, active));
+
+	int64_t distAccum[8];
+	int64_t distLanes[2][4];
+	_mm256_storeu_si256((__m256i*)distLanes[0], distEven);
+	_mm256_storeu_si256((__m256i*)distLanes[1], distOdd);
+	for (int i = 0; i < 8; i++)
+		distAccum[i] = distLanes[i & 1][i >> 1];
+
+	int bestIndex = 0;
+	int64_t min = INT64_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		if (distAccum[i] < min)
+		{
+			min = distAccum[i];
+			bestIndex = i;
+		}
+	}
+
+	int lanes[8];
+
+	/* Write converted samples */
+	for (int s = 0; s < sampleCount; s++)
+	{
+		_mm256_storeu_si256((__m256i*)lanes, inSamples[s + 2]);
+		pcmInOut[s + 2] = lanes[bestIndex];
+	}
+
+	/* Write ps */
+	_mm256_storeu_si256((__m256i*)lanes, scale);
+	adpcmOut[0] = (char)((bestIndex << 4) | (lanes[bestIndex] & 0xF));
+
+	/* Write output samples (remaining samples are zero) */
+	int best[14];
+	for (int s = 0; s < 14; s++)
+	{
+		_mm256_storeu_si256((__m256i*)lanes, outSamples[s]);
+		best[s] = s < sampleCount ? lanes[bestIndex] : 0;
+	}
+	for (int y = 0; y < 7; y++)
+	{
+		adpcmOut[y + 1] = (char)((best[y * 2] << 4) | (best[y * 2 + 1] & 0xF));
+	}
+}
+#endif
+
+EncodeFrameFunc GetEncodeFrameFunc()
+{
+#ifdef HAVE_AVX2
+	if (cpu_has_avx2())
+		return DSPEncodeFrameAVX2;
+#endif
+	return DSPEncodeFrame;
+}
+
 uint32_t getBytesForAdpcmSamples(uint32_t samples)
 {
 	uint32_t extraBytes = 0;
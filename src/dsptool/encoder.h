@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace dsptool {
@@ -21,10 +22,22 @@ struct ADPCMINFO {
 	int16_t loop_yn2;
 };
 
-void encode(const int16_t *src, uint8_t *dst, ADPCMINFO *cxt, uint32_t samples);
-void getLoopContext(uint8_t *src, ADPCMINFO *cxt, uint32_t samples);
+/* Error statistics of the decoded samples, accumulated while encoding */
+struct ENCODESTATS {
+	uint64_t sse;
+	uint64_t energy;
+	uint32_t peak;
+};
+
+void encode(const int16_t *src, uint8_t *dst, ADPCMINFO *cxt, uint32_t samples, uint32_t maxRecords = 0, uint32_t loopStart = 0, bool draft = false, ENCODESTATS *stats = NULL);
+
+/* Encodes samples with the coefficients and initial history (yn1, yn2) in cxt.
+ * The loop context is captured at sample loopStart while encoding. Draft mode
+ * trades quality for speed. If stats is given it receives the error of the
+ * decoded samples. */
+void encodeFrames(const int16_t *src, uint8_t *dst, ADPCMINFO *cxt, uint32_t samples, uint32_t loopStart = 0, bool draft = false, ENCODESTATS *stats = NULL);
 
-void correlateCoefs(const int16_t *src, uint32_t samples, int16_t *coefsOut);
+void correlateCoefs(const int16_t *src, uint32_t samples, int16_t *coefsOut, uint32_t maxRecords = 0, bool draft = false);
 
 uint32_t getBytesForAdpcmSamples(uint32_t samples);
 
@@ -0,0 +1,263 @@
+
+#include "gx2/attribute.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gx2 {
+
+GX2AttribFormat supported_attrib_formats[] = {
+	GX2_ATTRIB_FORMAT_UNORM_8,
+	GX2_ATTRIB_FORMAT_UNORM_8_8,
+	GX2_ATTRIB_FORMAT_UNORM_8_8_8_8,
+	GX2_ATTRIB_FORMAT_UNORM_16,
+	GX2_ATTRIB_FORMAT_UNORM_16_16,
+	GX2_ATTRIB_FORMAT_UNORM_16_16_16_16,
+	GX2_ATTRIB_FORMAT_UNORM_10_10_10_2,
+	GX2_ATTRIB_FORMAT_UINT_8,
+	GX2_ATTRIB_FORMAT_UINT_8_8,
+	GX2_ATTRIB_FORMAT_UINT_8_8_8_8,
+	GX2_ATTRIB_FORMAT_UINT_16,
+	GX2_ATTRIB_FORMAT_UINT_16_16,
+	GX2_ATTRIB_FORMAT_UINT_16_16_16_16,
+	GX2_ATTRIB_FORMAT_UINT_32,
+	GX2_ATTRIB_FORMAT_UINT_32_32,
+	GX2_ATTRIB_FORMAT_UINT_32_32_32,
+	GX2_ATTRIB_FORMAT_UINT_32_32_32_32,
+	GX2_ATTRIB_FORMAT_UINT_10_10_10_2,
+	GX2_ATTRIB_FORMAT_SNORM_8,
+	GX2_ATTRIB_FORMAT_SNORM_8_8,
+	GX2_ATTRIB_FORMAT_SNORM_8_8_8_8,
+	GX2_ATTRIB_FORMAT_SNORM_16,
+	GX2_ATTRIB_FORMAT_SNORM_16_16,
+	GX2_ATTRIB_FORMAT_SNORM_16_16_16_16,
+	GX2_ATTRIB_FORMAT_SNORM_10_10_10_2,
+	GX2_ATTRIB_FORMAT_SINT_8,
+	GX2_ATTRIB_FORMAT_SINT_8_8,
+	GX2_ATTRIB_FORMAT_SINT_8_8_8_8,
+	GX2_ATTRIB_FORMAT_SINT_16,
+	GX2_ATTRIB_FORMAT_SINT_16_16,
+	GX2_ATTRIB_FORMAT_SINT_16_16_16_16,
+	GX2_ATTRIB_FORMAT_SINT_32,
+	GX2_ATTRIB_FORMAT_SINT_32_32,
+	GX2_ATTRIB_FORMAT_SINT_32_32_32,
+	GX2_ATTRIB_FORMAT_SINT_32_32_32_32,
+	GX2_ATTRIB_FORMAT_SINT_10_10_10_2,
+	GX2_ATTRIB_FORMAT_FLOAT_16,
+	GX2_ATTRIB_FORMAT_FLOAT_16_16,
+	GX2_ATTRIB_FORMAT_FLOAT_16_16_16_16,
+	GX2_ATTRIB_FORMAT_FLOAT_32,
+	GX2_ATTRIB_FORMAT_FLOAT_32_32,
+	GX2_ATTRIB_FORMAT_FLOAT_32_32_32,
+	GX2_ATTRIB_FORMAT_FLOAT_32_32_32_32
+};
+
+size_t num_supported_attrib_formats = sizeof(supported_attrib_formats) / sizeof(supported_attrib_formats[0]);
+
+/* Number of records that are unpacked before they are converted to floats */
+const uint32_t CHUNK_RECORDS = 64;
+
+enum class Conversion {
+	Int,
+	Uint,
+	Norm,
+	Half,
+	Float
+};
+
+bool is_attrib_format_supported(GX2AttribFormat format) {
+	for (size_t i = 0; i < num_supported_attrib_formats; i++) {
+		if (supported_attrib_formats[i] == format) return true;
+	}
+	return false;
+}
+
+uint32_t attrib_component_bits(GX2AttribFormat format) {
+	switch (format & 0xFF) {
+		case 0x00: case 0x04: case 0x0A: return 8;
+		case 0x02: case 0x03: case 0x07: case 0x08: case 0x0E: case 0x0F: return 16;
+		case 0x0B: return 10;
+	}
+	return 32;
+}
+
+uint32_t attrib_format_components(GX2AttribFormat format) {
+	switch (format & 0xFF) {
+		case 0x00: case 0x02: case 0x03: case 0x05: case 0x06: return 1;
+		case 0x04: case 0x07: case 0x08: case 0x0C: case 0x0D: return 2;
+		case 0x10: case 0x11: return 3;
+	}
+	return 4;
+}
+
+uint32_t attrib_format_size(GX2AttribFormat format) {
+	if ((format & 0xFF) == 0x0B) return 4;
+	return attrib_format_components(format) * attrib_component_bits(format) / 8;
+}
+
+template <typename T> T read_be(const uint8_t *ptr);
+
+template <>
+uint8_t read_be<uint8_t>(const uint8_t *ptr) {
+	return ptr[0];
+}
+
+template <>
+uint16_t read_be<uint16_t>(const uint8_t *ptr) {
+	return (ptr[0] << 8) | ptr[1];
+}
+
+template <>
+uint32_t read_be<uint32_t>(const uint8_t *ptr) {
+	return ((uint32_t)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+}
+
+/* Reads big-endian components of type T (signed types are sign extended) */
+template <typename T, typename U>
+void unpack_components(int32_t *out, const uint8_t *in, uint32_t stride, uint32_t records, uint32_t components) {
+	for (uint32_t i = 0; i < records; i++) {
+		for (uint32_t c = 0; c < components; c++) {
+			*out++ = (T)read_be<U>(in + c * sizeof(U));
+		}
+		in += stride;
+	}
+}
+
+void unpack_10_10_10_2(int32_t *out, const uint8_t *in, uint32_t stride, uint32_t records, bool is_signed) {
+	for (uint32_t i = 0; i < records; i++) {
+		uint32_t value = read_be<uint32_t>(in);
+		if (is_signed) {
+			*out++ = (int32_t)(value << 22) >> 22;
+			*out++ = (int32_t)(value << 12) >> 22;
+			*out++ = (int32_t)(value << 2) >> 22;
+			*out++ = (int32_t)value >> 30;
+		}
+		else {
+			*out++ = value & 0x3FF;
+			*out++ = (value >> 10) & 0x3FF;
+			*out++ = (value >> 20) & 0x3FF;
+			*out++ = value >> 30;
+		}
+		in += stride;
+	}
+}
+
+float half_to_float(uint32_t half) {
+	uint32_t expmant = half & 0x7FFF;
+	uint32_t bits = expmant << 13;
+	
+	/* Rebias the exponent (this also handles denormals) */
+	float value;
+	memcpy(&value, &bits, 4);
+	value *= 0x1p112f;
+	memcpy(&bits, &value, 4);
+	
+	if (expmant > 0x7BFF) {
+		bits |= 0x7F800000;
+	}
+	bits |= (half & 0x8000) << 16;
+	
+	memcpy(&value, &bits, 4);
+	return value;
+}
+
+#ifdef HAVE_SSE2
+__m128 half_to_float(__m128i half) {
+	__m128i expmant = _mm_and_si128(half, _mm_set1_epi32(0x7FFF));
+	__m128i sign = _mm_slli_epi32(_mm_xor_si128(half, expmant), 16);
+	__m128 value = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), _mm_set1_ps(0x1p112f));
+	__m128i infnan = _mm_and_si128(
+		_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7BFF)), _mm_set1_epi32(0x7F800000)
+	);
+	return _mm_or_ps(value, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+}
+#endif
+
+/* The scale pattern repeats every 4 values, so n must be a multiple of 4 except for the last chunk */
+void convert_values(float *out, const int32_t *in, uint32_t n, Conversion conversion, const float *scale, float min) {
+	uint32_t i = 0;
+	
+#ifdef HAVE_SSE2
+	__m128 scalevec = _mm_loadu_ps(scale);
+	__m128 minvec = _mm_set1_ps(min);
+	for (; i + 4 <= n; i += 4) {
+		__m128i values = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128 result;
+		if (conversion == Conversion::Int) {
+			result = _mm_cvtepi32_ps(values);
+		}
+		else if (conversion == Conversion::Norm) {
+			result = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(values), scalevec), minvec);
+		}
+		else if (conversion == Conversion::Half) {
+			result = half_to_float(values);
+		}
+		else if (conversion == Conversion::Float) {
+			result = _mm_castsi128_ps(values);
+		}
+		else {
+			break;
+		}
+		_mm_storeu_ps(out + i, result);
+	}
+#endif
+	
+	for (; i < n; i++) {
+		if (conversion == Conversion::Int) out[i] = (float)in[i];
+		else if (conversion == Conversion::Uint) out[i] = (float)(uint32_t)in[i];
+		else if (conversion == Conversion::Norm) out[i] = std::max((float)in[i] / scale[i % 4], min);
+		else if (conversion == Conversion::Half) out[i] = half_to_float((uint32_t)in[i]);
+		else memcpy(&out[i], &in[i], 4);
+	}
+}
+
+void decode_attribute(float *out, const uint8_t *in, uint32_t stride, uint32_t count, GX2AttribFormat format) {
+	uint32_t components = attrib_format_components(format);
+	uint32_t bits = attrib_component_bits(format);
+	bool is_float = format & 0x800;
+	bool is_integer = format & 0x100;
+	bool is_signed = format & 0x200;
+	
+	Conversion conversion = Conversion::Norm;
+	if (is_float) {
+		conversion = bits == 16 ? Conversion::Half : Conversion::Float;
+	}
+	else if (is_integer) {
+		conversion = bits == 32 && !is_signed ? Conversion::Uint : Conversion::Int;
+	}
+	
+	float scale[4];
+	for (int i = 0; i < 4; i++) {
+		uint32_t size = bits == 10 && i == 3 ? 2 : bits;
+		scale[i] = is_signed ? (1 << (size - 1)) - 1 : (1 << size) - 1;
+	}
+	
+	float min = is_signed ? -1.0f : 0.0f;
+	
+	int32_t values[CHUNK_RECORDS * 4];
+	for (uint32_t base = 0; base < count; base += CHUNK_RECORDS) {
+		uint32_t records = std::min(count - base, CHUNK_RECORDS);
+		if (bits == 10) {
+			unpack_10_10_10_2(values, in, stride, records, is_signed);
+		}
+		else if (bits == 8) {
+			if (is_signed) unpack_components<int8_t, uint8_t>(values, in, stride, records, components);
+			else unpack_components<uint8_t, uint8_t>(values, in, stride, records, components);
+		}
+		else if (bits == 16) {
+			if (is_signed) unpack_components<int16_t, uint16_t>(values, in, stride, records, components);
+			else unpack_components<uint16_t, uint16_t>(values, in, stride, records, components);
+		}
+		else {
+			unpack_components<uint32_t, uint32_t>(values, in, stride, records, components);
+		}
+		
+		convert_values(out, values, records * components, conversion, scale, min);
+		
+		in += (size_t)records * stride;
+		out += records * components;
+	}
+}
+
+}
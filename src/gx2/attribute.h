@@ -0,0 +1,19 @@
+
+#pragma once
+
+#include "gx2/enum.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace gx2 {
+
+bool is_attrib_format_supported(GX2AttribFormat format);
+uint32_t attrib_format_size(GX2AttribFormat format);
+uint32_t attrib_format_components(GX2AttribFormat format);
+
+void decode_attribute(float *out, const uint8_t *in, uint32_t stride, uint32_t count, GX2AttribFormat format);
+
+extern GX2AttribFormat supported_attrib_formats[];
+extern size_t num_supported_attrib_formats;
+
+}
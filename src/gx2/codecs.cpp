@@ -3,6 +3,9 @@
 #include "gx2/compression.h"
 #include "gx2/helpers.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace gx2 {
 
 GX2SurfaceFormat supported_formats[] = {
@@ -99,4 +102,47 @@ void decode_pixels(uint8_t *dst, const uint8_t *src, uint32_t width, uint32_t he
 	}
 }
 
+void decode_tiles(
+	uint8_t *dst, const SliceLayout *src, uint32_t width, uint32_t height,
+	GX2SurfaceFormat format, uint32_t first_row, uint32_t num_rows
+) {
+	bool compressed = is_bc_format(format);
+	uint32_t end_row = std::min(src->height, first_row + std::min(num_rows, src->height));
+	for (uint32_t tile_y = first_row / 8; tile_y < (end_row + 7) / 8; tile_y++) {
+		uint32_t tile_height = std::min(src->height - tile_y * 8, 8u);
+		for (uint32_t tile_x = 0; tile_x < (src->width + 7) / 8; tile_x++) {
+			uint32_t tile_width = std::min(src->width - tile_x * 8, 8u);
+			const uint8_t *tile = src->data + get_tile_base(src, tile_x, tile_y);
+			
+			for (uint32_t y = 0; y < tile_height; y++) {
+				for (uint32_t x = 0; x < tile_width; x++) {
+					const uint8_t *element = tile + src->offsets[y * 8 + x];
+					uint32_t ex = tile_x * 8 + x;
+					uint32_t ey = tile_y * 8 + y;
+					
+					if (!compressed) {
+						uint32_t pixel = decode_pixel(element, format);
+						uint8_t *ptr = dst + ((size_t)ey * width + ex) * 4;
+						ptr[0] = pixel >> 24;
+						ptr[1] = (pixel >> 16) & 0xFF;
+						ptr[2] = (pixel >> 8) & 0xFF;
+						ptr[3] = pixel & 0xFF;
+						continue;
+					}
+					
+					uint8_t block[64];
+					decompress_block(block, element, format);
+					
+					uint32_t block_width = std::min(width - ex * 4, 4u);
+					uint32_t block_height = std::min(height - ey * 4, 4u);
+					for (uint32_t by = 0; by < block_height; by++) {
+						uint8_t *ptr = dst + (((size_t)ey * 4 + by) * width + ex * 4) * 4;
+						memcpy(ptr, block + by * 16, block_width * 4);
+					}
+				}
+			}
+		}
+	}
+}
+
 }
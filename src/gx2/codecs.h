@@ -2,12 +2,21 @@
 #pragma once
 
 #include "gx2/enum.h"
+#include "gx2/swizzle.h"
 #include <cstddef>
 #include <cstdint>
 
 namespace gx2 {
 
 void decode_pixels(uint8_t *dst, const uint8_t *src, uint32_t width, uint32_t height, GX2SurfaceFormat format);
+
+/* Decodes the given rows of elements of a slice straight from its layout, so
+ * tiled slices do not have to be deswizzled first. width and height are the
+ * dimensions of the slice in pixels. */
+void decode_tiles(
+	uint8_t *dst, const SliceLayout *src, uint32_t width, uint32_t height,
+	GX2SurfaceFormat format, uint32_t first_row, uint32_t num_rows
+);
 bool is_format_supported(GX2SurfaceFormat format);
 
 extern GX2SurfaceFormat supported_formats[];
@@ -122,6 +122,56 @@ enum GX2SurfaceFormat {
 	GX2_SURFACE_FORMAT_FLOAT_X8_X24 = 0x81C
 };
 
+enum GX2AttribFormat {
+	GX2_ATTRIB_FORMAT_UNORM_8 = 0x0,
+	GX2_ATTRIB_FORMAT_UNORM_8_8 = 0x4,
+	GX2_ATTRIB_FORMAT_UNORM_8_8_8_8 = 0xA,
+	GX2_ATTRIB_FORMAT_UNORM_16 = 0x2,
+	GX2_ATTRIB_FORMAT_UNORM_16_16 = 0x7,
+	GX2_ATTRIB_FORMAT_UNORM_16_16_16_16 = 0xE,
+	GX2_ATTRIB_FORMAT_UNORM_10_10_10_2 = 0xB,
+	
+	GX2_ATTRIB_FORMAT_UINT_8 = 0x100,
+	GX2_ATTRIB_FORMAT_UINT_8_8 = 0x104,
+	GX2_ATTRIB_FORMAT_UINT_8_8_8_8 = 0x10A,
+	GX2_ATTRIB_FORMAT_UINT_16 = 0x102,
+	GX2_ATTRIB_FORMAT_UINT_16_16 = 0x107,
+	GX2_ATTRIB_FORMAT_UINT_16_16_16_16 = 0x10E,
+	GX2_ATTRIB_FORMAT_UINT_32 = 0x105,
+	GX2_ATTRIB_FORMAT_UINT_32_32 = 0x10C,
+	GX2_ATTRIB_FORMAT_UINT_32_32_32 = 0x110,
+	GX2_ATTRIB_FORMAT_UINT_32_32_32_32 = 0x112,
+	GX2_ATTRIB_FORMAT_UINT_10_10_10_2 = 0x10B,
+	
+	GX2_ATTRIB_FORMAT_SNORM_8 = 0x200,
+	GX2_ATTRIB_FORMAT_SNORM_8_8 = 0x204,
+	GX2_ATTRIB_FORMAT_SNORM_8_8_8_8 = 0x20A,
+	GX2_ATTRIB_FORMAT_SNORM_16 = 0x202,
+	GX2_ATTRIB_FORMAT_SNORM_16_16 = 0x207,
+	GX2_ATTRIB_FORMAT_SNORM_16_16_16_16 = 0x20E,
+	GX2_ATTRIB_FORMAT_SNORM_10_10_10_2 = 0x20B,
+	
+	GX2_ATTRIB_FORMAT_SINT_8 = 0x300,
+	GX2_ATTRIB_FORMAT_SINT_8_8 = 0x304,
+	GX2_ATTRIB_FORMAT_SINT_8_8_8_8 = 0x30A,
+	GX2_ATTRIB_FORMAT_SINT_16 = 0x302,
+	GX2_ATTRIB_FORMAT_SINT_16_16 = 0x307,
+	GX2_ATTRIB_FORMAT_SINT_16_16_16_16 = 0x30E,
+	GX2_ATTRIB_FORMAT_SINT_32 = 0x305,
+	GX2_ATTRIB_FORMAT_SINT_32_32 = 0x30C,
+	GX2_ATTRIB_FORMAT_SINT_32_32_32 = 0x310,
+	GX2_ATTRIB_FORMAT_SINT_32_32_32_32 = 0x312,
+	GX2_ATTRIB_FORMAT_SINT_10_10_10_2 = 0x30B,
+	
+	GX2_ATTRIB_FORMAT_FLOAT_16 = 0x803,
+	GX2_ATTRIB_FORMAT_FLOAT_16_16 = 0x808,
+	GX2_ATTRIB_FORMAT_FLOAT_16_16_16_16 = 0x80F,
+	GX2_ATTRIB_FORMAT_FLOAT_32 = 0x806,
+	GX2_ATTRIB_FORMAT_FLOAT_32_32 = 0x80D,
+	GX2_ATTRIB_FORMAT_FLOAT_32_32_32 = 0x811,
+	GX2_ATTRIB_FORMAT_FLOAT_32_32_32_32 = 0x813
+};
+
 enum GX2ShaderMode {
 	GX2_SHADER_MODE_UNIFORM_REGISTER,
 	GX2_SHADER_MODE_UNIFORM_BLOCK,
@@ -3,9 +3,55 @@
 #include "gx2/surface.h"
 #include "gx2/helpers.h"
 #include "gx2/codecs.h"
+#include "gx2/swizzle.h"
+#include "parallel.h"
 #include <algorithm>
 #include <cstdlib>
+#include <utility>
+#include <vector>
 
+/* Smaller surfaces are converted on the calling thread */
+static const size_t MIN_BYTES_PER_THREAD = 256 * 1024;
+
+struct SliceTask {
+	uint32_t level;
+	uint32_t slice;
+	bool tiled;
+	gx2::SliceLayout src;
+	gx2::SliceLayout dst;
+};
+
+typedef std::pair<size_t, uint32_t> BandTask;
+
+static std::vector<SliceTask> get_slice_tasks(GX2Surface *surface) {
+	std::vector<SliceTask> tasks;
+	for (uint32_t level = 0; level < surface->mip_levels; level++) {
+		uint32_t depth = surface->depth;
+		if (surface->dim == GX2_SURFACE_DIM_TEXTURE_3D) {
+			depth = std::max(depth >> level, 1u);
+		}
+		for (uint32_t slice = 0; slice < depth; slice++) {
+			SliceTask task = {};
+			task.level = level;
+			task.slice = slice;
+			tasks.push_back(task);
+		}
+	}
+	return tasks;
+}
+
+/* Large slices are split into bands, so that a surface with a single slice
+ * is processed in parallel as well */
+static std::vector<BandTask> get_band_tasks(const std::vector<SliceTask> &slices) {
+	std::vector<BandTask> bands;
+	for (size_t i = 0; i < slices.size(); i++) {
+		if (!slices[i].tiled) continue;
+		for (uint32_t row = 0; row < slices[i].src.height; row += gx2::SLICE_BAND_ROWS) {
+			bands.emplace_back(i, row);
+		}
+	}
+	return bands;
+}
 
 bool gx2::convert_tilemode(GX2Surface *input, GX2Surface *output, GX2TileMode tilemode, uint8_t swizzle) {
 	*output = *input;
@@ -21,22 +67,48 @@ bool gx2::convert_tilemode(GX2Surface *input, GX2Surface *output, GX2TileMode ti
 		output->mipmaps = output->image + output->image_size;
 	}
 	
-	for (uint32_t level = 0; level < input->mip_levels; level++) {
-		uint32_t depth = input->depth;
-		if (input->dim == GX2_SURFACE_DIM_TEXTURE_3D) {
-			depth = std::max(depth >> level, 1u);
-		}
-		for (uint32_t slice = 0; slice < depth; slice++) {
-			GX2CopySurface(input, level, slice, output, level, slice);
+	std::vector<SliceTask> slices = get_slice_tasks(input);
+	size_t threads = get_thread_count(input->image_size + input->mipmap_size, MIN_BYTES_PER_THREAD);
+	
+	/* The slices are prepared in parallel first, which also fills the swizzle
+	 * cache. Slices that cannot be copied one micro tile at a time are copied
+	 * right away. */
+	parallel_for(slices.size(), [&](size_t i) {
+		SliceTask &task = slices[i];
+		task.tiled =
+			init_slice_layout(&task.src, input, task.level, task.slice) &&
+			init_slice_layout(&task.dst, output, task.level, task.slice) &&
+			can_copy_tiles(&task.src, &task.dst);
+		if (!task.tiled) {
+			GX2CopySurface(input, task.level, task.slice, output, task.level, task.slice);
 		}
-	}
+	}, threads);
+	
+	std::vector<BandTask> bands = get_band_tasks(slices);
+	parallel_for(bands.size(), [&](size_t i) {
+		const SliceTask &task = slices[bands[i].first];
+		copy_tiles(&task.src, &task.dst, bands[i].second, SLICE_BAND_ROWS);
+	}, threads);
 	
 	return true;
 }
 
 bool gx2::decode(GX2Surface *input, GX2Surface *output) {
+	/* Multisampled surfaces cannot be read one micro tile at a time, so they
+	 * are deswizzled first */
+	if (input->tile_mode != GX2_TILE_MODE_LINEAR_SPECIAL && input->aa != GX2_AA_MODE_1X) {
+		GX2Surface linear;
+		if (!convert_tilemode(input, &linear, GX2_TILE_MODE_LINEAR_SPECIAL, 0)) return false;
+		
+		bool result = decode(&linear, output);
+		free(linear.image);
+		return result;
+	}
+	
 	*output = *input;
 	output->format = GX2_SURFACE_FORMAT_UNORM_R8_G8_B8_A8;
+	output->tile_mode = GX2_TILE_MODE_LINEAR_SPECIAL;
+	output->swizzle &= 0xFFFF00FF;
 	GX2CalcSurfaceSizeAndAlignment(output);
 	
 	output->image = (uint8_t *)malloc(output->image_size + output->mipmap_size);
@@ -47,20 +119,35 @@ bool gx2::decode(GX2Surface *input, GX2Surface *output) {
 		output->mipmaps = output->image + output->image_size;
 	}
 	
-	for (uint32_t level = 0; level < input->mip_levels; level++) {
-		uint32_t depth = input->depth;
-		if (input->dim == GX2_SURFACE_DIM_TEXTURE_3D) {
-			depth = std::max(depth >> level, 1u);
-		}
-		
-		for (uint32_t slice = 0; slice < depth; slice++) {
-			uint8_t *src = get_mipmap_ptr(input, level, slice);
-			uint8_t *dst = get_mipmap_ptr(output, level, slice);
+	std::vector<SliceTask> slices = get_slice_tasks(input);
+	size_t threads = get_thread_count(input->image_size + input->mipmap_size, MIN_BYTES_PER_THREAD);
+	
+	/* Tiled slices are decoded straight from the tiled layout instead of being
+	 * deswizzled into a temporary buffer first */
+	parallel_for(slices.size(), [&](size_t i) {
+		SliceTask &task = slices[i];
+		task.tiled = init_slice_layout(&task.src, input, task.level, task.slice);
+		if (!task.tiled) {
+			uint8_t *src = get_mipmap_ptr(input, task.level, task.slice);
+			uint8_t *dst = get_mipmap_ptr(output, task.level, task.slice);
 			
-			uint32_t width = std::max(input->width >> level, 1u);
-			uint32_t height = std::max(input->height >> level, 1u);
+			uint32_t width = std::max(input->width >> task.level, 1u);
+			uint32_t height = std::max(input->height >> task.level, 1u);
 			decode_pixels(dst, src, width, height, input->format);
 		}
-	}
+	}, threads);
+	
+	std::vector<BandTask> bands = get_band_tasks(slices);
+	parallel_for(bands.size(), [&](size_t i) {
+		const SliceTask &task = slices[bands[i].first];
+		uint8_t *dst = get_mipmap_ptr(output, task.level, task.slice);
+		
+		uint32_t width = std::max(input->width >> task.level, 1u);
+		uint32_t height = std::max(input->height >> task.level, 1u);
+		if (is_1d_dim(input->dim)) {
+			height = 1;
+		}
+		decode_tiles(dst, &task.src, width, height, input->format, bands[i].second, SLICE_BAND_ROWS);
+	}, threads);
 	return true;
 }
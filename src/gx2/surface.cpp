@@ -1,6 +1,7 @@
 
 #include "gx2/surface.h"
 #include "gx2/helpers.h"
+#include "gx2/swizzle.h"
 #include "gx2/enum.h"
 #include "addrinterface.h"
 
@@ -61,29 +62,30 @@ ADDR_E_RETURNCODE addrlib_free(const ADDR_FREESYSMEM_INPUT *input) {
 	return ADDR_OK;
 }
 
-ADDR_HANDLE getaddrlib() {
-	static ADDR_HANDLE addrlib = NULL;
+static ADDR_HANDLE create_addrlib() {
+	ADDR_CREATE_INPUT input = {};
+	ADDR_CREATE_OUTPUT output = {};
 	
-	if (!addrlib) {
-		ADDR_CREATE_INPUT input = {};
-		ADDR_CREATE_OUTPUT output = {};
-		
-		input.size = sizeof(input);
-		input.chipEngine = CIASICIDGFXENGINE_R600;
-		input.chipFamily = 0x51;
-		input.chipRevision = 71;
-		input.createFlags.fillSizeFields = 1;
-		input.regValue.gbAddrConfig = 0x44902;
-		
-		input.callbacks.allocSysMem = addrlib_malloc;
-		input.callbacks.freeSysMem = addrlib_free;
-		
-		output.size = sizeof(output);
-		
-		AddrCreate(&input, &output);
-		
-		addrlib = output.hLib;
-	}
+	input.size = sizeof(input);
+	input.chipEngine = CIASICIDGFXENGINE_R600;
+	input.chipFamily = 0x51;
+	input.chipRevision = 71;
+	input.createFlags.fillSizeFields = 1;
+	input.regValue.gbAddrConfig = 0x44902;
+	
+	input.callbacks.allocSysMem = addrlib_malloc;
+	input.callbacks.freeSysMem = addrlib_free;
+	
+	output.size = sizeof(output);
+	
+	AddrCreate(&input, &output);
+	return output.hLib;
+}
+
+ADDR_HANDLE getaddrlib() {
+	/* Surfaces are converted on multiple threads, and the initialization of
+	 * a static local variable is thread-safe */
+	static ADDR_HANDLE addrlib = create_addrlib();
 	return addrlib;
 }
 
@@ -291,6 +293,11 @@ void GX2CopySurface(
 	GX2Surface *src, uint32_t src_level, uint32_t src_slice,
 	GX2Surface *dst, uint32_t dst_level, uint32_t dst_slice
 ) {
+	if (copy_slice_tiles(src, src_level, src_slice, dst, dst_level, dst_slice)) {
+		return;
+	}
+	
+	/* Multisampled surfaces and surfaces with different dimensions are copied element by element */
 	ADDR_COMPUTE_SURFACE_INFO_OUTPUT src_info;
 	ADDR_COMPUTE_SURFACE_INFO_OUTPUT dst_info;
 	get_surface_info(src, src_level, &src_info);
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "gx2/enum.h"
+#include "addrinterface.h"
 #include <cstdint>
 
 struct GX2Surface {
@@ -24,6 +25,14 @@ struct GX2Surface {
 	uint32_t mip_level_offset[13];
 };
 
+ADDR_HANDLE getaddrlib();
+void get_surface_info(GX2Surface *surface, uint32_t level, ADDR_COMPUTE_SURFACE_INFO_OUTPUT *info);
+void init_addrfromcoord_info(
+	GX2Surface *surface, uint32_t slice,
+	ADDR_COMPUTE_SURFACE_INFO_OUTPUT *surface_info,
+	ADDR_COMPUTE_SURFACE_ADDRFROMCOORD_INPUT *info
+);
+
 void GX2CalcSurfaceSizeAndAlignment(GX2Surface *surface);
 void GX2CopySurface(
 	GX2Surface *src, uint32_t src_level, uint32_t src_slice,
@@ -0,0 +1,219 @@
+
+#include "gx2/swizzle.h"
+#include "gx2/helpers.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace gx2 {
+
+/* Every address computation goes through addrlib, so a thread is only worth
+ * starting for a few thousand micro tiles */
+static const size_t MIN_TILES_PER_THREAD = 4096;
+
+typedef void (*CopyTileFunc)(
+	uint8_t *dst, const int64_t *dst_offsets, const uint8_t *src, const int64_t *src_offsets,
+	uint32_t width, uint32_t height
+);
+
+static uint64_t compute_addr(ADDR_COMPUTE_SURFACE_ADDRFROMCOORD_INPUT *input, uint32_t x, uint32_t y) {
+	ADDR_COMPUTE_SURFACE_ADDRFROMCOORD_OUTPUT output = {};
+	output.size = sizeof(output);
+	
+	input->x = x;
+	input->y = y;
+	AddrComputeSurfaceAddrFromCoord(getaddrlib(), input, &output);
+	return output.addr;
+}
+
+static std::shared_ptr<const TileTable> build_tile_table(
+	ADDR_COMPUTE_SURFACE_ADDRFROMCOORD_INPUT *input, uint32_t width, uint32_t height
+) {
+	std::shared_ptr<TileTable> table = std::make_shared<TileTable>();
+	table->tiles_x = (width + 7) / 8;
+	table->tiles_y = (height + 7) / 8;
+	table->bases.resize((size_t)table->tiles_x * table->tiles_y);
+	
+	/* The offsets within a micro tile are the same for every micro tile of
+	 * the slice, so they are taken from the first one */
+	uint32_t tile_width = std::min(width, 8u);
+	uint32_t tile_height = std::min(height, 8u);
+	uint64_t base = compute_addr(input, 0, 0);
+	memset(table->offsets, 0, sizeof(table->offsets));
+	for (uint32_t y = 0; y < tile_height; y++) {
+		for (uint32_t x = 0; x < tile_width; x++) {
+			table->offsets[y * 8 + x] = (int64_t)(compute_addr(input, x, y) - base);
+		}
+	}
+	
+	size_t threads = get_thread_count(table->bases.size(), MIN_TILES_PER_THREAD);
+	parallel_for(table->tiles_y, [&](size_t tile_y) {
+		ADDR_COMPUTE_SURFACE_ADDRFROMCOORD_INPUT row_input = *input;
+		for (uint32_t tile_x = 0; tile_x < table->tiles_x; tile_x++) {
+			table->bases[tile_y * table->tiles_x + tile_x] = compute_addr(&row_input, tile_x * 8, tile_y * 8);
+		}
+	}, threads);
+	return table;
+}
+
+static std::shared_ptr<const TileTable> get_tile_table(
+	GX2Surface *surface, uint32_t slice, ADDR_COMPUTE_SURFACE_INFO_OUTPUT *info,
+	uint32_t width, uint32_t height
+) {
+	ADDR_COMPUTE_SURFACE_ADDRFROMCOORD_INPUT input;
+	init_addrfromcoord_info(surface, slice, info, &input);
+	
+	TileTableKey key;
+	key.tile_mode = input.tileMode;
+	key.bpp = input.bpp;
+	key.pitch = input.pitch;
+	key.height = input.height;
+	key.num_slices = input.numSlices;
+	key.slice = input.slice;
+	key.is_depth = input.isDepth;
+	key.pipe_swizzle = input.pipeSwizzle;
+	key.bank_swizzle = input.bankSwizzle;
+	key.width = width;
+	key.rows = height;
+	
+	std::shared_ptr<const TileTable> table = find_tile_table(key);
+	if (!table) {
+		table = build_tile_table(&input, width, height);
+		insert_tile_table(key, table);
+	}
+	return table;
+}
+
+bool init_slice_layout(SliceLayout *layout, GX2Surface *surface, uint32_t level, uint32_t slice) {
+	uint32_t bpp = surface_format_bpp[surface->format & 0x3F];
+	if (surface->aa != GX2_AA_MODE_1X || bpp == 0 || bpp % 8) {
+		return false;
+	}
+	
+	ADDR_COMPUTE_SURFACE_INFO_OUTPUT info;
+	get_surface_info(surface, level, &info);
+	
+	layout->data = get_mipmap_ptr(surface, level);
+	layout->width = std::max(surface->width >> level, 1u);
+	layout->height = std::max(surface->height >> level, 1u);
+	if (is_1d_dim(surface->dim)) {
+		layout->height = 1;
+	}
+	if (is_bc_format(surface->format)) {
+		layout->width = (layout->width + 3) / 4;
+		layout->height = (layout->height + 3) / 4;
+	}
+	layout->bytes = bpp / 8;
+	
+	uint32_t tile_width = std::min(layout->width, 8u);
+	uint32_t tile_height = std::min(layout->height, 8u);
+	
+	memset(layout->offsets, 0, sizeof(layout->offsets));
+	
+	layout->linear = surface->tile_mode == GX2_TILE_MODE_LINEAR_SPECIAL;
+	if (layout->linear) {
+		layout->row_pitch = (uint64_t)info.pitch * layout->bytes;
+		layout->linear_base = (uint64_t)slice * layout->height * layout->row_pitch;
+		for (uint32_t y = 0; y < tile_height; y++) {
+			for (uint32_t x = 0; x < tile_width; x++) {
+				layout->offsets[y * 8 + x] = y * layout->row_pitch + x * layout->bytes;
+			}
+		}
+	}
+	else {
+		layout->table = get_tile_table(surface, slice, &info, layout->width, layout->height);
+		memcpy(layout->offsets, layout->table->offsets, sizeof(layout->offsets));
+	}
+	
+	layout->contiguous_rows = true;
+	for (uint32_t y = 0; y < tile_height; y++) {
+		for (uint32_t x = 0; x < tile_width; x++) {
+			if (layout->offsets[y * 8 + x] != layout->offsets[y * 8] + x * layout->bytes) {
+				layout->contiguous_rows = false;
+			}
+		}
+	}
+	return true;
+}
+
+uint64_t get_tile_base(const SliceLayout *layout, uint32_t tile_x, uint32_t tile_y) {
+	if (layout->linear) {
+		return layout->linear_base + tile_y * 8 * layout->row_pitch + tile_x * 8 * layout->bytes;
+	}
+	return layout->table->bases[(size_t)tile_y * layout->table->tiles_x + tile_x];
+}
+
+template <size_t Bytes>
+static void copy_tile(
+	uint8_t *dst, const int64_t *dst_offsets, const uint8_t *src, const int64_t *src_offsets,
+	uint32_t width, uint32_t height
+) {
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			memcpy(dst + dst_offsets[y * 8 + x], src + src_offsets[y * 8 + x], Bytes);
+		}
+	}
+}
+
+static CopyTileFunc get_copy_tile_func(uint32_t bytes) {
+	switch (bytes) {
+		case 1: return copy_tile<1>;
+		case 2: return copy_tile<2>;
+		case 4: return copy_tile<4>;
+		case 8: return copy_tile<8>;
+		case 12: return copy_tile<12>;
+		case 16: return copy_tile<16>;
+	}
+	return NULL;
+}
+
+bool can_copy_tiles(const SliceLayout *src, const SliceLayout *dst) {
+	if (src->width != dst->width || src->height != dst->height) return false;
+	if (src->bytes != dst->bytes) return false;
+	return get_copy_tile_func(src->bytes) != NULL;
+}
+
+void copy_tiles(const SliceLayout *src, const SliceLayout *dst, uint32_t first_row, uint32_t num_rows) {
+	CopyTileFunc copy = get_copy_tile_func(src->bytes);
+	
+	/* Micro tiles whose rows are contiguous on both sides are copied row by row */
+	bool copy_rows = src->contiguous_rows && dst->contiguous_rows;
+	
+	uint32_t width = src->width;
+	uint32_t height = std::min(src->height, first_row + std::min(num_rows, src->height));
+	for (uint32_t tile_y = first_row / 8; tile_y < (height + 7) / 8; tile_y++) {
+		uint32_t tile_height = std::min(src->height - tile_y * 8, 8u);
+		for (uint32_t tile_x = 0; tile_x < (width + 7) / 8; tile_x++) {
+			uint32_t tile_width = std::min(width - tile_x * 8, 8u);
+			
+			uint8_t *dst_tile = dst->data + get_tile_base(dst, tile_x, tile_y);
+			const uint8_t *src_tile = src->data + get_tile_base(src, tile_x, tile_y);
+			
+			if (copy_rows) {
+				for (uint32_t y = 0; y < tile_height; y++) {
+					memcpy(dst_tile + dst->offsets[y * 8], src_tile + src->offsets[y * 8], tile_width * src->bytes);
+				}
+			}
+			else {
+				copy(dst_tile, dst->offsets, src_tile, src->offsets, tile_width, tile_height);
+			}
+		}
+	}
+}
+
+bool copy_slice_tiles(
+	GX2Surface *src, uint32_t src_level, uint32_t src_slice,
+	GX2Surface *dst, uint32_t dst_level, uint32_t dst_slice
+) {
+	SliceLayout src_layout;
+	SliceLayout dst_layout;
+	if (!init_slice_layout(&src_layout, src, src_level, src_slice)) return false;
+	if (!init_slice_layout(&dst_layout, dst, dst_level, dst_slice)) return false;
+	if (!can_copy_tiles(&src_layout, &dst_layout)) return false;
+	
+	copy_tiles(&src_layout, &dst_layout, 0, src_layout.height);
+	return true;
+}
+
+}
@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include "gx2/surface.h"
+#include "gx2/swizzle_cache.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace gx2 {
+
+/* Describes where the elements of one slice of a mip level are stored. The
+ * address of an element is the base address of its 8x8 micro tile plus an
+ * offset that only depends on the position of the element within the micro
+ * tile. Only single-sampled surfaces with whole-byte elements are supported.
+ * The addresses of tiled surfaces are looked up in the swizzle cache. */
+struct SliceLayout {
+	uint8_t *data;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytes;
+	
+	/* Linear special surfaces are addressed without addrlib */
+	bool linear;
+	uint64_t linear_base;
+	uint64_t row_pitch;
+	
+	std::shared_ptr<const TileTable> table;
+	
+	int64_t offsets[64];
+	bool contiguous_rows;
+};
+
+bool init_slice_layout(SliceLayout *layout, GX2Surface *surface, uint32_t level, uint32_t slice);
+uint64_t get_tile_base(const SliceLayout *layout, uint32_t tile_x, uint32_t tile_y);
+
+/* Slices are split into bands of this many rows when they are copied on
+ * multiple threads. This is a multiple of the height of every macro tile. */
+const uint32_t SLICE_BAND_ROWS = 64;
+
+bool can_copy_tiles(const SliceLayout *src, const SliceLayout *dst);
+
+/* Copies the micro tiles that contain the given rows. Different rows of a
+ * slice are stored at different addresses, so bands can be copied in
+ * parallel. first_row must be a multiple of 8. */
+void copy_tiles(const SliceLayout *src, const SliceLayout *dst, uint32_t first_row, uint32_t num_rows);
+
+/* Copies the elements of one slice to a slice with the same dimensions and
+ * element size, one micro tile at a time. Returns false without copying
+ * anything if either surface is not supported. */
+bool copy_slice_tiles(
+	GX2Surface *src, uint32_t src_level, uint32_t src_slice,
+	GX2Surface *dst, uint32_t dst_level, uint32_t dst_slice
+);
+
+}
@@ -0,0 +1,127 @@
+
+#include "gx2/swizzle_cache.h"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace gx2 {
+
+static const size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+bool TileTableKey::operator==(const TileTableKey &other) const {
+	return tile_mode == other.tile_mode && bpp == other.bpp && pitch == other.pitch &&
+	       height == other.height && num_slices == other.num_slices && slice == other.slice &&
+	       is_depth == other.is_depth && pipe_swizzle == other.pipe_swizzle &&
+	       bank_swizzle == other.bank_swizzle && width == other.width && rows == other.rows;
+}
+
+struct TileTableKeyHash {
+	size_t operator()(const TileTableKey &key) const {
+		const uint32_t fields[] = {
+			key.tile_mode, key.bpp, key.pitch, key.height, key.num_slices, key.slice,
+			key.is_depth, key.pipe_swizzle, key.bank_swizzle, key.width, key.rows
+		};
+		
+		/* FNV-1a over the fields */
+		uint64_t hash = 0xCBF29CE484222325;
+		for (uint32_t field : fields) {
+			hash = (hash ^ field) * 0x100000001B3;
+		}
+		return hash;
+	}
+};
+
+typedef std::pair<TileTableKey, std::shared_ptr<const TileTable>> CacheEntry;
+
+/* The most recently used table is at the front of the list */
+struct SwizzleCache {
+	std::mutex mutex;
+	std::list<CacheEntry> entries;
+	std::unordered_map<TileTableKey, std::list<CacheEntry>::iterator, TileTableKeyHash> index;
+	size_t size = 0;
+	size_t capacity = DEFAULT_CAPACITY;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+static SwizzleCache &get_cache() {
+	static SwizzleCache cache;
+	return cache;
+}
+
+static void evict(SwizzleCache &cache, size_t capacity) {
+	while (cache.size > capacity) {
+		CacheEntry &entry = cache.entries.back();
+		cache.size -= get_tile_table_size(entry.second.get());
+		cache.index.erase(entry.first);
+		cache.entries.pop_back();
+	}
+}
+
+size_t get_tile_table_size(const TileTable *table) {
+	return sizeof(TileTable) + table->bases.size() * sizeof(uint64_t);
+}
+
+std::shared_ptr<const TileTable> find_tile_table(const TileTableKey &key) {
+	SwizzleCache &cache = get_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	
+	auto it = cache.index.find(key);
+	if (it == cache.index.end()) {
+		cache.misses++;
+		return nullptr;
+	}
+	
+	cache.hits++;
+	cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+	return it->second->second;
+}
+
+void insert_tile_table(const TileTableKey &key, std::shared_ptr<const TileTable> table) {
+	SwizzleCache &cache = get_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	
+	size_t size = get_tile_table_size(table.get());
+	if (size > cache.capacity) return;
+	
+	/* Another thread may have built the same table in the meantime */
+	if (cache.index.count(key)) return;
+	
+	evict(cache, cache.capacity - size);
+	
+	cache.entries.emplace_front(key, std::move(table));
+	cache.index[key] = cache.entries.begin();
+	cache.size += size;
+}
+
+void set_swizzle_cache_capacity(size_t capacity) {
+	SwizzleCache &cache = get_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	
+	cache.capacity = capacity;
+	evict(cache, capacity);
+}
+
+void get_swizzle_cache_stats(SwizzleCacheStats *stats) {
+	SwizzleCache &cache = get_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	
+	stats->hits = cache.hits;
+	stats->misses = cache.misses;
+	stats->entries = cache.entries.size();
+	stats->size = cache.size;
+	stats->capacity = cache.capacity;
+}
+
+void clear_swizzle_cache() {
+	SwizzleCache &cache = get_cache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	
+	evict(cache, 0);
+	cache.hits = 0;
+	cache.misses = 0;
+}
+
+}
@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gx2 {
+
+/* Everything that determines the addresses of the elements of a tiled slice */
+struct TileTableKey {
+	uint32_t tile_mode;
+	uint32_t bpp;
+	uint32_t pitch;
+	uint32_t height;
+	uint32_t num_slices;
+	uint32_t slice;
+	uint32_t is_depth;
+	uint32_t pipe_swizzle;
+	uint32_t bank_swizzle;
+	uint32_t width;
+	uint32_t rows;
+	
+	bool operator==(const TileTableKey &other) const;
+};
+
+/* The base address of every micro tile of a slice, and the offsets of the
+ * elements within a micro tile */
+struct TileTable {
+	uint32_t tiles_x;
+	uint32_t tiles_y;
+	int64_t offsets[64];
+	std::vector<uint64_t> bases;
+};
+
+struct SwizzleCacheStats {
+	uint64_t hits;
+	uint64_t misses;
+	size_t entries;
+	size_t size;
+	size_t capacity;
+};
+
+/* Tables are kept in a least recently used cache that is shared between
+ * threads. The returned table stays valid even if it is evicted. */
+std::shared_ptr<const TileTable> find_tile_table(const TileTableKey &key);
+void insert_tile_table(const TileTableKey &key, std::shared_ptr<const TileTable> table);
+
+size_t get_tile_table_size(const TileTable *table);
+
+void set_swizzle_cache_capacity(size_t capacity);
+void get_swizzle_cache_stats(SwizzleCacheStats *stats);
+void clear_swizzle_cache();
+
+}
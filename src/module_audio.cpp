@@ -1,117 +1,49 @@
 
-#define PY_SSIZE_T_CLEAN
-
+#include "module_audio.h"
+#include "type_adpcm_decoder.h"
+#include "type_stream_reader.h"
+#include "type_ima_adpcm_decoder.h"
+#include "type_ima_adpcm_encoder.h"
+#include "type_resampler.h"
+#include "audio/adpcm.h"
+#include "audio/ima_adpcm.h"
+#include "audio/interleave.h"
+#include "audio/pcm8.h"
+#include "audio/resample.h"
+#include "audio/sample.h"
 #include "dsptool/encoder.h"
+#include "parallel.h"
 
-#include <Python.h>
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 
 
-struct ADPCMContext {
-	int16_t coefs[16];
-	uint8_t header;
-	int16_t hist1;
-	int16_t hist2;
-};
-
-
-int16_t clamp(int val) {
-	if (val < -32768) return -32768;
-	if (val > 32767) return 32767;
-	return val;
-}
-
-void decode_pcm8(int16_t *out, const int8_t *in, uint32_t numSamples) {
-	for (uint32_t i = 0; i < numSamples; i++) {
-		out[i] = in[i] << 8;
-	}
-}
-
-void encode_pcm8(int8_t *out, const int16_t *in, uint32_t numSamples) {
-	for (uint32_t i = 0; i < numSamples; i++) {
-		int16_t sample = in[i];
-		if (sample < 0x7F80) {
-			sample += 0x80;
-		}
-		
-		out[i] = sample >> 8;
-	}
-}
-
-bool decode_adpcm(
-	int16_t *out, const uint8_t *in, uint32_t numSamples, ADPCMContext *ctx
-) {
-	int nybble;
-	int coefIdx;
-	int scale = 0;
-	int coef1 = 0;
-	int coef2 = 0;
-	uint8_t byte = 0;
-	
-	for (uint32_t i = 0; i < numSamples; i++) {
-		if (i % 14 == 0) {
-			ctx->header = *in++;
-			scale = 1 << (ctx->header & 0xF);
-			coefIdx = ctx->header >> 4;
-			if (coefIdx >= 8) {
-				return false;
-			}
-			coef1 = ctx->coefs[coefIdx * 2];
-			coef2 = ctx->coefs[coefIdx * 2 + 1];
-		}
-		
-		if (i % 2) {
-			nybble = byte & 0xF;
-		}
-		else {
-			byte = *in++;
-			nybble = byte >> 4;
-		}
-		
-		if (nybble >= 8) {
-			nybble -= 16;
+PyObject *build_coef_list(const int16_t *coefs) {
+	PyObject *list = PyList_New(16);
+	if (!list) return NULL;
+	
+	for (size_t i = 0; i < 16; i++) {
+		PyObject *item = Py_BuildValue("h", coefs[i]);
+		if (!item) {
+			Py_DECREF(list);
+			return NULL;
 		}
 		
-		int scaled = (nybble * scale) << 11;
-		int hist = coef1 * ctx->hist1 + coef2 * ctx->hist2;
-		int16_t sample = clamp((scaled + hist + 1024) >> 11);
-		
-		ctx->hist2 = ctx->hist1;
-		ctx->hist1 = sample;
-		if (out) {
-			*out++ = sample;
-		}
+		PyList_SetItem(list, i, item);
 	}
-	return true;
-}
-
-void encode_adpcm(
-	uint8_t *out, const int16_t *in, uint32_t samples, ADPCMContext *ctx
-) {
-	dsptool::ADPCMINFO info;
-	dsptool::encode(in,  out, &info, samples);
-	
-	memcpy(ctx->coefs, info.coef, sizeof(info.coef));
-	ctx->header = info.pred_scale;
-	ctx->hist1 = info.yn1;
-	ctx->hist2 = info.yn2;
+	return list;
 }
 
-bool parse_adpcm_args(PyObject *args, const uint8_t **in, size_t *inlen, uint32_t *samples, ADPCMContext *ctx) {
-	PyObject *coefList;
-	if (!PyArg_ParseTuple(args, "y#iO!", in, inlen, samples, &PyList_Type, &coefList)) {
-		return false;
-	}
-	
-	size_t size = PyList_Size(coefList);
+bool parse_coef_list(PyObject *list, int16_t *coefs) {
+	size_t size = PyList_Size(list);
 	if (size != 16) {
 		PyErr_SetString(PyExc_ValueError, "len(coefs) must be 16");
 		return false;
 	}
 	
-	memset(ctx, 0, sizeof(*ctx));
 	for (size_t i = 0; i < 16; i++) {
-		PyObject *item = PyList_GetItem(coefList, i);
+		PyObject *item = PyList_GetItem(list, i);
 		if (!PyLong_Check(item)) {
 			PyErr_SetString(PyExc_TypeError, "coefs must contain only integers");
 			return false;
@@ -125,15 +57,49 @@ bool parse_adpcm_args(PyObject *args, const uint8_t **in, size_t *inlen, uint32_
 			return false;
 		}
 		
-		ctx->coefs[i] = value;
+		coefs[i] = value;
+	}
+	return true;
+}
+
+bool check_ima_index(long index) {
+	if (index < 0 || index > 88) {
+		PyErr_SetString(PyExc_ValueError, "step index must be between 0 and 88");
+		return false;
+	}
+	return true;
+}
+
+bool check_resample_args(uint32_t in_rate, uint32_t out_rate, uint32_t channels) {
+	if (!in_rate || !out_rate || in_rate > 1000000 || out_rate > 1000000) {
+		PyErr_SetString(PyExc_ValueError, "sample rate must be between 1 and 1000000");
+		return false;
+	}
+	
+	if (in_rate > out_rate * 64ull || out_rate > in_rate * 64ull) {
+		PyErr_SetString(PyExc_ValueError, "sample rates must not differ by more than a factor of 64");
+		return false;
+	}
+	
+	if (!channels || channels >= 0x10000) {
+		PyErr_SetString(PyExc_ValueError, "invalid number of channels");
+		return false;
+	}
+	return true;
+}
+
+bool parse_adpcm_args(PyObject *args, const uint8_t **in, size_t *inlen, uint32_t *samples, audio::ADPCMContext *ctx) {
+	PyObject *coefList;
+	if (!PyArg_ParseTuple(args, "y#iO!", in, inlen, samples, &PyList_Type, &coefList)) {
+		return false;
 	}
 	
-	size_t bytesNeeded = *samples / 14 * 8;
-	if (*samples % 14) {
-		bytesNeeded += (*samples % 14 + 1) / 2 + 1;
+	memset(ctx, 0, sizeof(*ctx));
+	if (!parse_coef_list(coefList, ctx->coefs)) {
+		return false;
 	}
 	
-	if (bytesNeeded > *inlen) {
+	if (audio::get_adpcm_size(*samples) > *inlen) {
 		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
 		return false;
 	}
@@ -141,13 +107,27 @@ bool parse_adpcm_args(PyObject *args, const uint8_t **in, size_t *inlen, uint32_
 	return true;
 }
 
-PyObject *Audio_interleave(PyObject *self, PyObject *args) {
-	if (!PyList_Check(args)) {
+PyObject *Audio_interleave(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"channels", "block_size", "big_endian", NULL};
+	
+	PyObject *list;
+	uint32_t block_size = 1;
+	int big_endian = false;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|Ip", (char **)keywords, &list, &block_size, &big_endian)) {
+		return NULL;
+	}
+	
+	if (!PyList_Check(list)) {
 		PyErr_SetString(PyExc_TypeError, "channels must be a list object");
 		return NULL;
 	}
 	
-	size_t count = PyList_Size(args);
+	if (!block_size) {
+		PyErr_SetString(PyExc_ValueError, "block size must not be 0");
+		return NULL;
+	}
+	
+	size_t count = PyList_Size(list);
 	if (!count) {
 		return PyBytes_FromString("");
 	}
@@ -159,7 +139,7 @@ PyObject *Audio_interleave(PyObject *self, PyObject *args) {
 	
 	ssize_t size;
 	for (size_t i = 0; i < count; i++) {
-		PyObject *channel = PyList_GetItem(args, i);
+		PyObject *channel = PyList_GetItem(list, i);
 		if (!PyBytes_Check(channel)) {
 			PyErr_SetString(PyExc_TypeError, "channel must be a bytes object");
 			return NULL;
@@ -185,39 +165,48 @@ PyObject *Audio_interleave(PyObject *self, PyObject *args) {
 		}
 	}
 	
+	/* Keep the channels alive while the GIL is released */
+	PyObject *tuple = PyList_AsTuple(list);
+	if (!tuple) return NULL;
+	
 	const int16_t **channels = (const int16_t **)malloc(count * sizeof(int16_t *));
 	if (!channels) {
+		Py_DECREF(tuple);
 		return PyErr_NoMemory();
 	}
 	
 	PyObject *bytes = PyBytes_FromStringAndSize(NULL, count * size);
 	if (!bytes) {
+		Py_DECREF(tuple);
 		free(channels);
 		return NULL;
 	}
 	
 	for (size_t i = 0; i < count; i++) {
-		PyObject *channel = PyList_GetItem(args, i);
-		channels[i] = (const int16_t *)PyBytes_AsString(channel);
+		channels[i] = (const int16_t *)PyBytes_AS_STRING(PyTuple_GET_ITEM(tuple, i));
 	}
 	
-	int16_t *out = (int16_t *)PyBytes_AsString(bytes);
-	for (ssize_t i = 0; i < size / 2; i++) {
-		for (size_t j = 0; j < count; j++) {
-			out[i * count + j] = channels[j][i];
-		}
-	}
+	int16_t *out = (int16_t *)PyBytes_AS_STRING(bytes);
+	
+	Py_BEGIN_ALLOW_THREADS
+	audio::interleave(out, channels, count, size / 2, block_size, big_endian);
+	Py_END_ALLOW_THREADS
 	
+	Py_DECREF(tuple);
 	free(channels);
 	return bytes;
 }
 
-PyObject *Audio_deinterleave(PyObject *self, PyObject *args) {
+PyObject *Audio_deinterleave(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "channels", "block_size", "big_endian", NULL};
+	
 	const int16_t *in;
 	size_t inlen;
 	int channels;
+	uint32_t block_size = 1;
+	int big_endian = false;
 	
-	if (!PyArg_ParseTuple(args, "y#i", &in, &inlen, &channels)) {
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#i|Ip", (char **)keywords, &in, &inlen, &channels, &block_size, &big_endian)) {
 		return NULL;
 	}
 	
@@ -226,13 +215,24 @@ PyObject *Audio_deinterleave(PyObject *self, PyObject *args) {
 		return NULL;
 	}
 	
+	if (!block_size) {
+		PyErr_SetString(PyExc_ValueError, "block size must not be 0");
+		return NULL;
+	}
+	
 	if (inlen % (channels * 2)) {
 		PyErr_SetString(PyExc_ValueError, "number of samples must be divisible by number of channels");
 		return NULL;
 	}
 	
+	int16_t **outputs = (int16_t **)malloc(channels * sizeof(int16_t *));
+	if (!outputs) {
+		return PyErr_NoMemory();
+	}
+	
 	PyObject *list = PyList_New(channels);
 	if (!list) {
+		free(outputs);
 		return NULL;
 	}
 	
@@ -240,44 +240,131 @@ PyObject *Audio_deinterleave(PyObject *self, PyObject *args) {
 		PyObject *bytes = PyBytes_FromStringAndSize(NULL, inlen / channels);
 		if (!bytes) {
 			Py_DECREF(list);
+			free(outputs);
 			return NULL;
 		}
 		
-		int16_t *samples = (int16_t *)PyBytes_AsString(bytes);
-		for (size_t samp = 0; samp < inlen / channels / 2; samp++) {
-			samples[samp] = in[samp * channels + chan];
+		outputs[chan] = (int16_t *)PyBytes_AS_STRING(bytes);
+		PyList_SET_ITEM(list, chan, bytes);
+	}
+	
+	Py_BEGIN_ALLOW_THREADS
+	audio::deinterleave(outputs, in, channels, inlen / channels / 2, block_size, big_endian);
+	Py_END_ALLOW_THREADS
+	
+	free(outputs);
+	return list;
+}
+
+/* Creates a list of count bytes objects of the given size and stores their buffers in outputs */
+PyObject *build_channel_list(void **outputs, size_t count, size_t size) {
+	PyObject *list = PyList_New(count);
+	if (!list) return NULL;
+	
+	for (size_t chan = 0; chan < count; chan++) {
+		PyObject *bytes = PyBytes_FromStringAndSize(NULL, size);
+		if (!bytes) {
+			Py_DECREF(list);
+			return NULL;
 		}
 		
-		PyList_SetItem(list, chan, bytes);
+		outputs[chan] = PyBytes_AS_STRING(bytes);
+		PyList_SET_ITEM(list, chan, bytes);
 	}
-	
 	return list;
 }
 
-PyObject *Audio_decode_pcm8(PyObject *self, PyObject *args) {
+PyObject *Audio_decode_pcm8(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "float32", "channels", NULL};
+	
 	const int8_t *in;
 	size_t inlen;
+	int float32 = false;
+	int channels = 0;
 	
-	if (!PyArg_ParseTuple(args, "y#", &in, &inlen)) {
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#|pi", (char **)keywords, &in, &inlen, &float32, &channels)) {
 		return NULL;
 	}
 	
-	PyObject *bytes = PyBytes_FromStringAndSize(NULL, inlen * 2);
-	if (!bytes) return NULL;
+	size_t sampleSize = float32 ? 4 : 2;
+	
+	if (!channels) {
+		PyObject *bytes = PyBytes_FromStringAndSize(NULL, inlen * sampleSize);
+		if (!bytes) return NULL;
+		
+		char *out = PyBytes_AsString(bytes);
+		
+		Py_BEGIN_ALLOW_THREADS
+		if (float32) {
+			audio::decode_pcm8((float *)out, in, inlen);
+		}
+		else {
+			audio::decode_pcm8((int16_t *)out, in, inlen);
+		}
+		Py_END_ALLOW_THREADS
+		
+		return bytes;
+	}
 	
-	int16_t *out = (int16_t *)PyBytes_AsString(bytes);
-	decode_pcm8(out, in, inlen);
+	if (channels < 0 || channels >= 65536) {
+		PyErr_SetString(PyExc_ValueError, "invalid number of channels");
+		return NULL;
+	}
 	
-	return bytes;
+	if (inlen % channels) {
+		PyErr_SetString(PyExc_ValueError, "number of samples must be divisible by number of channels");
+		return NULL;
+	}
+	
+	void **outputs = (void **)malloc(channels * sizeof(void *));
+	if (!outputs) {
+		return PyErr_NoMemory();
+	}
+	
+	size_t samples = inlen / channels;
+	PyObject *list = build_channel_list(outputs, channels, samples * sampleSize);
+	if (!list) {
+		free(outputs);
+		return NULL;
+	}
+	
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		audio::decode_pcm8((float **)outputs, in, channels, samples);
+	}
+	else {
+		audio::decode_pcm8((int16_t **)outputs, in, channels, samples);
+	}
+	Py_END_ALLOW_THREADS
+	
+	free(outputs);
+	return list;
 }
 
-PyObject *Audio_decode_adpcm(PyObject *self, PyObject *args) {
+PyObject *Audio_decode_adpcm(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "samples", "coefs", "float32", NULL};
+	
 	const uint8_t *in;
 	size_t inlen;
 	uint32_t samples;
-	ADPCMContext ctx;
+	PyObject *coefList;
+	int float32 = false;
 	
-	if (!parse_adpcm_args(args, &in, &inlen, &samples, &ctx)) {
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#iO!|p", (char **)keywords, &in, &inlen, &samples,
+		&PyList_Type, &coefList, &float32
+	)) {
+		return NULL;
+	}
+	
+	audio::ADPCMContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	if (!parse_coef_list(coefList, ctx.coefs)) {
+		return NULL;
+	}
+	
+	if (audio::get_adpcm_size(samples) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
 		return NULL;
 	}
 	
@@ -286,12 +373,18 @@ PyObject *Audio_decode_adpcm(PyObject *self, PyObject *args) {
 		return NULL;
 	}
 	
-	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * 2);
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * (float32 ? 4 : 2));
 	if (!bytes) return NULL;
 	
-	int16_t *out = (int16_t *)PyBytes_AsString(bytes);
+	char *out = PyBytes_AsString(bytes);
 	
-	bool result = decode_adpcm(out, in, samples, &ctx);
+	bool result;
+	if (float32) {
+		result = audio::decode_adpcm((float *)out, in, samples, &ctx);
+	}
+	else {
+		result = audio::decode_adpcm((int16_t *)out, in, samples, &ctx);
+	}
 	
 	if (!result) {
 		Py_DECREF(bytes);
@@ -302,11 +395,15 @@ PyObject *Audio_decode_adpcm(PyObject *self, PyObject *args) {
 	return bytes;
 }
 
-PyObject *Audio_encode_pcm8(PyObject *self, PyObject *args) {
+PyObject *Audio_encode_pcm8(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "big_endian", "channels", NULL};
+	
 	const int16_t *in;
 	size_t inlen;
+	int big_endian = false;
+	int channels = 0;
 	
-	if (!PyArg_ParseTuple(args, "y#", &in, &inlen)) {
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#|pi", (char **)keywords, &in, &inlen, &big_endian, &channels)) {
 		return NULL;
 	}
 	
@@ -315,20 +412,99 @@ PyObject *Audio_encode_pcm8(PyObject *self, PyObject *args) {
 		return NULL;
 	}
 	
-	PyObject *bytes = PyBytes_FromStringAndSize(NULL, inlen / 2);
-	if (!bytes) return NULL;
+	if (!channels) {
+		PyObject *bytes = PyBytes_FromStringAndSize(NULL, inlen / 2);
+		if (!bytes) return NULL;
+		
+		int8_t *out = (int8_t *)PyBytes_AsString(bytes);
+		
+		Py_BEGIN_ALLOW_THREADS
+		audio::encode_pcm8(out, in, inlen / 2, big_endian);
+		Py_END_ALLOW_THREADS
+		
+		return bytes;
+	}
 	
-	int8_t *out = (int8_t *)PyBytes_AsString(bytes);
-	encode_pcm8(out, in, inlen / 2);
+	if (channels < 0 || channels >= 65536) {
+		PyErr_SetString(PyExc_ValueError, "invalid number of channels");
+		return NULL;
+	}
 	
-	return bytes;
+	if (inlen % (channels * 2)) {
+		PyErr_SetString(PyExc_ValueError, "number of samples must be divisible by number of channels");
+		return NULL;
+	}
+	
+	void **outputs = (void **)malloc(channels * sizeof(void *));
+	if (!outputs) {
+		return PyErr_NoMemory();
+	}
+	
+	size_t samples = inlen / 2 / channels;
+	PyObject *list = build_channel_list(outputs, channels, samples);
+	if (!list) {
+		free(outputs);
+		return NULL;
+	}
+	
+	Py_BEGIN_ALLOW_THREADS
+	audio::encode_pcm8((int8_t **)outputs, in, channels, samples, big_endian);
+	Py_END_ALLOW_THREADS
+	
+	free(outputs);
+	return list;
+}
+
+/* Returns a (sse, peak, snr) tuple. The SNR is in dB. */
+PyObject *build_adpcm_stats(const audio::ADPCMStats *stats) {
+	double snr;
+	if (stats->sse == 0) {
+		snr = HUGE_VAL;
+	}
+	else if (stats->energy == 0) {
+		snr = -HUGE_VAL;
+	}
+	else {
+		snr = 10 * log10((double)stats->energy / stats->sse);
+	}
+	return Py_BuildValue("KId", (unsigned long long)stats->sse, stats->peak, snr);
 }
 
-PyObject *Audio_encode_adpcm(PyObject *self, PyObject *args) {
+PyObject *Audio_encode_adpcm(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "max_records", "coefs", "hist1", "hist2", "loop_start", "draft", "big_endian", "stats", NULL};
+	
 	const int16_t *in;
 	size_t inlen;
+	uint32_t max_records = 0;
+	PyObject *coefList = NULL;
+	PyObject *loopObj = Py_None;
+	int draft = false;
+	int big_endian = false;
+	int stats = false;
+	
+	audio::ADPCMContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#|IO!hhOppp", (char **)keywords, &in, &inlen, &max_records,
+		&PyList_Type, &coefList, &ctx.hist1, &ctx.hist2, &loopObj, &draft, &big_endian, &stats
+	)) {
+		return NULL;
+	}
+	
+	Py_ssize_t loop_start = -1;
+	if (loopObj != Py_None) {
+		loop_start = PyLong_AsSsize_t(loopObj);
+		if (loop_start == -1 && PyErr_Occurred()) {
+			return NULL;
+		}
+		if (loop_start < 0) {
+			PyErr_SetString(PyExc_ValueError, "loop start is out of range");
+			return NULL;
+		}
+	}
 	
-	if (!PyArg_ParseTuple(args, "y#", &in, &inlen)) {
+	if (coefList && !parse_coef_list(coefList, ctx.coefs)) {
 		return NULL;
 	}
 	
@@ -338,83 +514,817 @@ PyObject *Audio_encode_adpcm(PyObject *self, PyObject *args) {
 	}
 	
 	size_t samples = inlen / 2;
-	size_t bytesNeeded = samples / 14 * 8;
-	if (samples % 14) {
-		bytesNeeded += (samples % 14 + 1) / 2 + 1;
+	if (loop_start >= 0 && (size_t)loop_start >= samples) {
+		PyErr_SetString(PyExc_ValueError, "loop start is out of range");
+		return NULL;
 	}
 	
+	/* The encoder reads every sample several times, so big-endian input is swapped once up front */
+	int16_t *swapped = NULL;
+	if (big_endian) {
+		swapped = (int16_t *)malloc(samples * 2 + 1);
+		if (!swapped) {
+			return PyErr_NoMemory();
+		}
+	}
+	
+	size_t bytesNeeded = audio::get_adpcm_size(samples);
+	
 	PyObject *bytes = PyBytes_FromStringAndSize(NULL, bytesNeeded);
-	if (!bytes) return NULL;
+	if (!bytes) {
+		free(swapped);
+		return NULL;
+	}
 	
 	uint8_t *out = (uint8_t *)PyBytes_AsString(bytes);
 	
-	ADPCMContext ctx;
-	encode_adpcm(out, in, samples, &ctx);
+	audio::ADPCMContext loopCtx;
+	audio::ADPCMContext *loopPtr = loop_start >= 0 ? &loopCtx : NULL;
+	uint32_t loopStart = loop_start >= 0 ? loop_start : 0;
 	
-	PyObject *list = PyList_New(16);
+	audio::ADPCMStats encodeStats;
+	audio::ADPCMStats *statsPtr = stats ? &encodeStats : NULL;
+	
+	Py_BEGIN_ALLOW_THREADS
+	if (swapped) {
+		for (size_t i = 0; i < samples; i++) {
+			swapped[i] = audio::swap_sample(in[i]);
+		}
+		in = swapped;
+	}
+	
+	if (coefList) {
+		audio::encode_adpcm_frames(out, in, samples, &ctx, loopStart, loopPtr, draft, statsPtr);
+	}
+	else {
+		audio::encode_adpcm(out, in, samples, &ctx, max_records, loopStart, loopPtr, draft, statsPtr);
+	}
+	Py_END_ALLOW_THREADS
+	
+	free(swapped);
+	
+	PyObject *list = build_coef_list(ctx.coefs);
 	if (!list) {
 		Py_DECREF(bytes);
 		return NULL;
 	}
 	
-	for (size_t i = 0; i < 16; i++) {
-		PyObject *item = Py_BuildValue("h", ctx.coefs[i]);
-		if (!item) {
-			Py_DECREF(bytes);
-			Py_DECREF(list);
+	PyObject *result = PyTuple_New(2 + (loopPtr != NULL) + (statsPtr != NULL));
+	if (!result) {
+		Py_DECREF(bytes);
+		Py_DECREF(list);
+		return NULL;
+	}
+	
+	PyTuple_SET_ITEM(result, 0, bytes);
+	PyTuple_SET_ITEM(result, 1, list);
+	
+	Py_ssize_t index = 2;
+	if (loopPtr) {
+		PyObject *loop = Py_BuildValue("Bhh", loopCtx.header, loopCtx.hist1, loopCtx.hist2);
+		if (!loop) {
+			Py_DECREF(result);
 			return NULL;
 		}
-		
-		PyList_SetItem(list, i, item);
+		PyTuple_SET_ITEM(result, index++, loop);
+	}
+	if (statsPtr) {
+		PyObject *statsTuple = build_adpcm_stats(statsPtr);
+		if (!statsTuple) {
+			Py_DECREF(result);
+			return NULL;
+		}
+		PyTuple_SET_ITEM(result, index++, statsTuple);
 	}
-	
-	PyObject *result = Py_BuildValue("OO", bytes, list);
-	Py_DECREF(bytes);
-	Py_DECREF(list);
 	
 	return result;
 }
 
-PyObject *Audio_get_adpcm_context(PyObject *self, PyObject *args) {
-	const uint8_t *in;
-	size_t inlen;
-	uint32_t samples;
-	ADPCMContext ctx;
+/* A few short clips are encoded faster on the calling thread */
+static const size_t MIN_SAMPLES_PER_THREAD = 1024 * 14;
+
+/* Encodes every bytes object in the tuple on a pool of worker threads and
+ * returns a list of (data, coefs) tuples in the same order */
+PyObject *encode_adpcm_clips(PyObject *tuple, uint32_t max_records, bool draft) {
+	size_t count = PyTuple_GET_SIZE(tuple);
 	
-	if (!parse_adpcm_args(args, &in, &inlen, &samples, &ctx)) {
-		return NULL;
+	audio::ADPCMContext *contexts = (audio::ADPCMContext *)calloc(count, sizeof(audio::ADPCMContext));
+	size_t *order = (size_t *)malloc(count * sizeof(size_t) + 1);
+	if (!contexts || !order) {
+		free(contexts);
+		free(order);
+		return PyErr_NoMemory();
 	}
 	
-	bool result = decode_adpcm(NULL, in, samples, &ctx);
-	if (!result) {
-		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+	PyObject *data = PyList_New(count);
+	if (!data) {
+		free(contexts);
+		free(order);
 		return NULL;
 	}
 	
-	return Py_BuildValue("Bhh", ctx.header, ctx.hist1, ctx.hist2);
+	size_t total = 0;
+	for (size_t i = 0; i < count; i++) {
+		size_t samples = PyBytes_GET_SIZE(PyTuple_GET_ITEM(tuple, i)) / 2;
+		total += samples;
+		PyObject *bytes = PyBytes_FromStringAndSize(NULL, audio::get_adpcm_size(samples));
+		if (!bytes) {
+			Py_DECREF(data);
+			free(contexts);
+			free(order);
+			return NULL;
+		}
+		PyList_SET_ITEM(data, i, bytes);
+		order[i] = i;
+	}
+	
+	Py_BEGIN_ALLOW_THREADS
+	/* Start with the longest clips so that the workers finish at about the same time */
+	std::stable_sort(order, order + count, [&](size_t a, size_t b) {
+		return PyBytes_GET_SIZE(PyTuple_GET_ITEM(tuple, a)) > PyBytes_GET_SIZE(PyTuple_GET_ITEM(tuple, b));
+	});
+	
+	parallel_for(count, [&](size_t index) {
+		size_t i = order[index];
+		PyObject *clip = PyTuple_GET_ITEM(tuple, i);
+		uint8_t *out = (uint8_t *)PyBytes_AS_STRING(PyList_GET_ITEM(data, i));
+		const int16_t *in = (const int16_t *)PyBytes_AS_STRING(clip);
+		audio::encode_adpcm(out, in, PyBytes_GET_SIZE(clip) / 2, &contexts[i], max_records, 0, NULL, draft);
+	}, get_thread_count(total, MIN_SAMPLES_PER_THREAD));
+	Py_END_ALLOW_THREADS
+	
+	PyObject *result = PyList_New(count);
+	if (result) {
+		for (size_t i = 0; i < count; i++) {
+			PyObject *coefs = build_coef_list(contexts[i].coefs);
+			PyObject *item = coefs ? Py_BuildValue("ON", PyList_GET_ITEM(data, i), coefs) : NULL;
+			if (!item) {
+				Py_CLEAR(result);
+				break;
+			}
+			PyList_SET_ITEM(result, i, item);
+		}
+	}
+	
+	Py_DECREF(data);
+	free(contexts);
+	free(order);
+	return result;
 }
 
+/* Returns a tuple with the items of the list, which keeps them alive while the GIL is released */
+PyObject *get_pcm_clips(PyObject *list, const char *name) {
+	PyObject *tuple = PyList_AsTuple(list);
+	if (!tuple) return NULL;
+	
+	for (ssize_t i = 0; i < PyTuple_GET_SIZE(tuple); i++) {
+		PyObject *clip = PyTuple_GET_ITEM(tuple, i);
+		if (!PyBytes_Check(clip)) {
+			Py_DECREF(tuple);
+			PyErr_Format(PyExc_TypeError, "%s must be a bytes object", name);
+			return NULL;
+		}
+		
+		if (PyBytes_GET_SIZE(clip) % 2) {
+			Py_DECREF(tuple);
+			PyErr_Format(PyExc_ValueError, "%s must contain an even number of bytes", name);
+			return NULL;
+		}
+	}
+	return tuple;
+}
 
-PyMethodDef AudioMethods[] = {
-	{"interleave", Audio_interleave, METH_O, NULL},
-	{"deinterleave", Audio_deinterleave, METH_VARARGS, NULL},
-	{"decode_pcm8", Audio_decode_pcm8, METH_VARARGS, NULL},
-	{"encode_pcm8", Audio_encode_pcm8, METH_VARARGS, NULL},
-	{"decode_adpcm", Audio_decode_adpcm, METH_VARARGS, NULL},
-	{"encode_adpcm", Audio_encode_adpcm, METH_VARARGS, NULL},
-	{"get_adpcm_context", Audio_get_adpcm_context, METH_VARARGS, NULL},
-	NULL
-};
-
-PyModuleDef AudioModule = {
-	PyModuleDef_HEAD_INIT,
-	"audio",
-	"Audio conversion",
-	-1,
-
-	AudioMethods
+PyObject *Audio_encode_adpcm_multi(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"channels", "block_size", "max_records", "draft", NULL};
+	
+	PyObject *list;
+	uint32_t block_size = 0;
+	uint32_t max_records = 0;
+	int draft = false;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!|IIp", (char **)keywords, &PyList_Type, &list, &block_size, &max_records, &draft)) {
+		return NULL;
+	}
+	
+	if (block_size % 8) {
+		PyErr_SetString(PyExc_ValueError, "block size must be a multiple of 8");
+		return NULL;
+	}
+	
+	PyObject *tuple = get_pcm_clips(list, "channel");
+	if (!tuple) return NULL;
+	
+	size_t count = PyTuple_GET_SIZE(tuple);
+	if (!count || count >= 0x10000) {
+		Py_DECREF(tuple);
+		PyErr_SetString(PyExc_ValueError, "invalid number of channels");
+		return NULL;
+	}
+	
+	ssize_t size = PyBytes_GET_SIZE(PyTuple_GET_ITEM(tuple, 0));
+	for (size_t i = 1; i < count; i++) {
+		if (PyBytes_GET_SIZE(PyTuple_GET_ITEM(tuple, i)) != size) {
+			Py_DECREF(tuple);
+			PyErr_SetString(PyExc_ValueError, "every channel must contain the same number of bytes");
+			return NULL;
+		}
+	}
+	
+	PyObject *encoded = encode_adpcm_clips(tuple, max_records, draft);
+	Py_DECREF(tuple);
+	
+	if (!encoded || !block_size) {
+		return encoded;
+	}
+	
+	size_t bytesNeeded = audio::get_adpcm_size(size / 2);
+	
+	uint8_t **outputs = (uint8_t **)malloc(count * sizeof(uint8_t *));
+	PyObject *data = PyBytes_FromStringAndSize(NULL, audio::get_block_interleaved_size(bytesNeeded, count, block_size));
+	PyObject *coefs = PyList_New(count);
+	if (!outputs || !data || !coefs) {
+		free(outputs);
+		Py_XDECREF(data);
+		Py_XDECREF(coefs);
+		Py_DECREF(encoded);
+		return outputs ? NULL : PyErr_NoMemory();
+	}
+	
+	for (size_t i = 0; i < count; i++) {
+		PyObject *item = PyList_GET_ITEM(encoded, i);
+		outputs[i] = (uint8_t *)PyBytes_AS_STRING(PyTuple_GET_ITEM(item, 0));
+		
+		PyObject *coefList = PyTuple_GET_ITEM(item, 1);
+		Py_INCREF(coefList);
+		PyList_SET_ITEM(coefs, i, coefList);
+	}
+	
+	Py_BEGIN_ALLOW_THREADS
+	audio::interleave_blocks((uint8_t *)PyBytes_AS_STRING(data), outputs, count, bytesNeeded, block_size);
+	Py_END_ALLOW_THREADS
+	
+	free(outputs);
+	Py_DECREF(encoded);
+	return Py_BuildValue("NN", data, coefs);
+}
+
+PyObject *Audio_encode_adpcm_many(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"clips", "max_records", "draft", NULL};
+	
+	PyObject *list;
+	uint32_t max_records = 0;
+	int draft = false;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!|Ip", (char **)keywords, &PyList_Type, &list, &max_records, &draft)) {
+		return NULL;
+	}
+	
+	PyObject *tuple = get_pcm_clips(list, "clip");
+	if (!tuple) return NULL;
+	
+	if (!PyTuple_GET_SIZE(tuple)) {
+		Py_DECREF(tuple);
+		PyErr_SetString(PyExc_ValueError, "invalid number of clips");
+		return NULL;
+	}
+	
+	PyObject *result = encode_adpcm_clips(tuple, max_records, draft);
+	Py_DECREF(tuple);
+	return result;
+}
+
+PyObject *Audio_get_adpcm_context(PyObject *self, PyObject *args) {
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t samples;
+	audio::ADPCMContext ctx;
+	
+	if (!parse_adpcm_args(args, &in, &inlen, &samples, &ctx)) {
+		return NULL;
+	}
+	
+	bool result = audio::decode_adpcm((int16_t *)NULL, in, samples, &ctx);
+	if (!result) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+		return NULL;
+	}
+	
+	return Py_BuildValue("Bhh", ctx.header, ctx.hist1, ctx.hist2);
+}
+
+PyObject *Audio_get_adpcm_seek_table(PyObject *self, PyObject *args) {
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t samples;
+	PyObject *coefList;
+	uint32_t interval;
+	
+	if (!PyArg_ParseTuple(args, "y#IO!I", &in, &inlen, &samples, &PyList_Type, &coefList, &interval)) {
+		return NULL;
+	}
+	
+	if (!interval || interval % 14) {
+		PyErr_SetString(PyExc_ValueError, "interval must be a positive multiple of 14");
+		return NULL;
+	}
+	
+	audio::ADPCMContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	if (!parse_coef_list(coefList, ctx.coefs)) {
+		return NULL;
+	}
+	
+	if (audio::get_adpcm_size(samples) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
+		return NULL;
+	}
+	
+	size_t entries = samples / interval + (samples % interval != 0);
+	int16_t *table = (int16_t *)malloc(entries * 4 + 1);
+	if (!table) {
+		return PyErr_NoMemory();
+	}
+	
+	bool result;
+	Py_BEGIN_ALLOW_THREADS
+	result = audio::get_adpcm_seek_table(table, in, samples, interval, &ctx);
+	Py_END_ALLOW_THREADS
+	
+	if (!result) {
+		free(table);
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+		return NULL;
+	}
+	
+	PyObject *list = PyList_New(entries);
+	if (!list) {
+		free(table);
+		return NULL;
+	}
+	
+	for (size_t i = 0; i < entries; i++) {
+		PyObject *item = Py_BuildValue("hh", table[i * 2], table[i * 2 + 1]);
+		if (!item) {
+			Py_DECREF(list);
+			free(table);
+			return NULL;
+		}
+		PyList_SET_ITEM(list, i, item);
+	}
+	
+	free(table);
+	return list;
+}
+
+PyObject *Audio_decode_adpcm_range(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "coefs", "seek_table", "interval", "start", "samples", "float32", NULL};
+	
+	const uint8_t *in;
+	size_t inlen;
+	PyObject *coefList;
+	PyObject *seekTable;
+	uint32_t interval;
+	uint32_t start;
+	uint32_t samples;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#O!O!III|p", (char **)keywords, &in, &inlen, &PyList_Type, &coefList,
+		&PyList_Type, &seekTable, &interval, &start, &samples, &float32
+	)) {
+		return NULL;
+	}
+	
+	if (!interval || interval % 14) {
+		PyErr_SetString(PyExc_ValueError, "interval must be a positive multiple of 14");
+		return NULL;
+	}
+	
+	if (samples > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	audio::ADPCMContext ctx;
+	memset(&ctx, 0, sizeof(ctx));
+	if (!parse_coef_list(coefList, ctx.coefs)) {
+		return NULL;
+	}
+	
+	size_t index = start / interval;
+	if (index >= (size_t)PyList_Size(seekTable)) {
+		PyErr_SetString(PyExc_IndexError, "start sample is not covered by the seek table");
+		return NULL;
+	}
+	
+	PyObject *entry = PyList_GetItem(seekTable, index);
+	if (!PyTuple_Check(entry)) {
+		PyErr_SetString(PyExc_TypeError, "seek table must contain tuples");
+		return NULL;
+	}
+	
+	if (!PyArg_ParseTuple(entry, "hh", &ctx.hist1, &ctx.hist2)) {
+		return NULL;
+	}
+	
+	if (audio::get_adpcm_size((size_t)start + samples) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	size_t offset = index * interval / 14 * 8;
+	
+	bool result;
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		result = audio::decode_adpcm_range((float *)out, in + offset, start - index * interval, samples, &ctx);
+	}
+	else {
+		result = audio::decode_adpcm_range((int16_t *)out, in + offset, start - index * interval, samples, &ctx);
+	}
+	Py_END_ALLOW_THREADS
+	
+	if (!result) {
+		Py_DECREF(bytes);
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+		return NULL;
+	}
+	
+	return bytes;
+}
+
+PyObject *Audio_decode_adpcm_blocks(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "samples", "block_size", "coefs", "history", "float32", NULL};
+	
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t samples;
+	uint32_t block_size;
+	PyObject *coefLists;
+	PyObject *history = NULL;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#IIO!|O!p", (char **)keywords, &in, &inlen, &samples, &block_size,
+		&PyList_Type, &coefLists, &PyList_Type, &history, &float32
+	)) {
+		return NULL;
+	}
+	
+	if (!block_size || block_size % 8) {
+		PyErr_SetString(PyExc_ValueError, "block size must be a positive multiple of 8");
+		return NULL;
+	}
+	
+	size_t channels = PyList_Size(coefLists);
+	if (!channels || channels >= 0x10000) {
+		PyErr_SetString(PyExc_ValueError, "invalid number of channels");
+		return NULL;
+	}
+	
+	if (history && (size_t)PyList_Size(history) != channels) {
+		PyErr_SetString(PyExc_ValueError, "history must contain one entry per channel");
+		return NULL;
+	}
+	
+	if (samples * channels > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	size_t size = audio::get_adpcm_size(samples);
+	if (audio::get_block_interleaved_size(size, channels, block_size) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
+		return NULL;
+	}
+	
+	audio::ADPCMContext *contexts = (audio::ADPCMContext *)calloc(channels, sizeof(audio::ADPCMContext));
+	if (!contexts) {
+		return PyErr_NoMemory();
+	}
+	
+	for (size_t i = 0; i < channels; i++) {
+		PyObject *coefList = PyList_GetItem(coefLists, i);
+		if (!PyList_Check(coefList)) {
+			free(contexts);
+			PyErr_SetString(PyExc_TypeError, "coefs must contain a list for every channel");
+			return NULL;
+		}
+		
+		if (!parse_coef_list(coefList, contexts[i].coefs)) {
+			free(contexts);
+			return NULL;
+		}
+		
+		if (history) {
+			PyObject *entry = PyList_GetItem(history, i);
+			if (!PyTuple_Check(entry)) {
+				free(contexts);
+				PyErr_SetString(PyExc_TypeError, "history must contain tuples");
+				return NULL;
+			}
+			
+			if (!PyArg_ParseTuple(entry, "hh", &contexts[i].hist1, &contexts[i].hist2)) {
+				free(contexts);
+				return NULL;
+			}
+		}
+	}
+	
+	size_t sampleSize = float32 ? 4 : 2;
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * channels * sampleSize);
+	if (!bytes) {
+		free(contexts);
+		return NULL;
+	}
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	bool result;
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		result = audio::decode_adpcm_blocks((float *)out, in, samples, channels, block_size, contexts);
+	}
+	else {
+		result = audio::decode_adpcm_blocks((int16_t *)out, in, samples, channels, block_size, contexts);
+	}
+	Py_END_ALLOW_THREADS
+	
+	free(contexts);
+	
+	if (!result) {
+		Py_DECREF(bytes);
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+		return NULL;
+	}
+	
+	return bytes;
+}
+
+PyObject *Audio_decode_ima_adpcm(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "samples", "predictor", "index", "float32", NULL};
+	
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t samples;
+	int16_t predictor = 0;
+	int index = 0;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#I|hip", (char **)keywords, &in, &inlen, &samples,
+		&predictor, &index, &float32
+	)) {
+		return NULL;
+	}
+	
+	if (!check_ima_index(index)) {
+		return NULL;
+	}
+	
+	if (samples > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	if (audio::get_ima_adpcm_size(samples) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	audio::IMAADPCMContext ctx;
+	ctx.predictor = predictor;
+	ctx.index = index;
+	
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		audio::decode_ima_adpcm((float *)out, in, samples, &ctx);
+	}
+	else {
+		audio::decode_ima_adpcm((int16_t *)out, in, samples, &ctx);
+	}
+	Py_END_ALLOW_THREADS
+	
+	return bytes;
+}
+
+PyObject *Audio_encode_ima_adpcm(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "predictor", "index", "big_endian", NULL};
+	
+	const int16_t *in;
+	size_t inlen;
+	int16_t predictor = 0;
+	int index = 0;
+	int big_endian = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#|hip", (char **)keywords, &in, &inlen, &predictor, &index, &big_endian
+	)) {
+		return NULL;
+	}
+	
+	if (!check_ima_index(index)) {
+		return NULL;
+	}
+	
+	if (inlen % 2) {
+		PyErr_SetString(PyExc_ValueError, "buffer must contain an even number of bytes");
+		return NULL;
+	}
+	
+	if (inlen / 2 > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, audio::get_ima_adpcm_size(inlen / 2));
+	if (!bytes) return NULL;
+	
+	uint8_t *out = (uint8_t *)PyBytes_AS_STRING(bytes);
+	
+	audio::IMAADPCMContext ctx;
+	ctx.predictor = predictor;
+	ctx.index = index;
+	
+	Py_BEGIN_ALLOW_THREADS
+	audio::encode_ima_adpcm(out, in, inlen / 2, &ctx, big_endian);
+	Py_END_ALLOW_THREADS
+	
+	return bytes;
+}
+
+PyObject *Audio_decode_ima_adpcm_blocks(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "block_size", "channels", "float32", NULL};
+	
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t block_size;
+	uint32_t channels = 1;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#I|Ip", (char **)keywords, &in, &inlen, &block_size, &channels, &float32
+	)) {
+		return NULL;
+	}
+	
+	if (block_size <= 4) {
+		PyErr_SetString(PyExc_ValueError, "block size must be greater than 4");
+		return NULL;
+	}
+	
+	if (!channels || channels >= 0x10000) {
+		PyErr_SetString(PyExc_ValueError, "invalid number of channels");
+		return NULL;
+	}
+	
+	if (inlen % ((size_t)block_size * channels) % channels) {
+		PyErr_SetString(PyExc_ValueError, "the last block of every channel must have the same size");
+		return NULL;
+	}
+	
+	if (inlen / channels > 0x2000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	size_t samples = audio::get_ima_adpcm_block_samples(inlen, channels, block_size);
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * channels * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		audio::decode_ima_adpcm_blocks((float *)out, in, inlen, channels, block_size);
+	}
+	else {
+		audio::decode_ima_adpcm_blocks((int16_t *)out, in, inlen, channels, block_size);
+	}
+	Py_END_ALLOW_THREADS
+	
+	return bytes;
+}
+
+PyObject *Audio_resample(PyObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "in_rate", "out_rate", "channels", "float32", NULL};
+	
+	const int16_t *in;
+	size_t inlen;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t channels = 1;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(
+		args, kwargs, "y#II|Ip", (char **)keywords, &in, &inlen, &in_rate, &out_rate, &channels, &float32
+	)) {
+		return NULL;
+	}
+	
+	if (!check_resample_args(in_rate, out_rate, channels)) {
+		return NULL;
+	}
+	
+	if (inlen % (channels * 2)) {
+		PyErr_SetString(PyExc_ValueError, "number of samples must be divisible by number of channels");
+		return NULL;
+	}
+	
+	audio::Resampler resampler;
+	if (!audio::init_resampler(&resampler, in_rate, out_rate, channels)) {
+		return PyErr_NoMemory();
+	}
+	
+	size_t frames = inlen / 2 / channels;
+	size_t count = audio::get_resample_count(&resampler, frames);
+	size_t total = ((uint64_t)frames * resampler.up + resampler.down - 1) / resampler.down;
+	
+	size_t sampleSize = float32 ? 4 : 2;
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, total * channels * sampleSize);
+	if (!bytes) {
+		audio::free_resampler(&resampler);
+		return NULL;
+	}
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		audio::resample(&resampler, (float *)out, in, frames);
+		audio::flush_resampler(&resampler, (float *)out + count * channels);
+	}
+	else {
+		audio::resample(&resampler, (int16_t *)out, in, frames);
+		audio::flush_resampler(&resampler, (int16_t *)out + count * channels);
+	}
+	Py_END_ALLOW_THREADS
+	
+	audio::free_resampler(&resampler);
+	return bytes;
+}
+
+
+PyMethodDef AudioMethods[] = {
+	{"interleave", (PyCFunction)Audio_interleave, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"deinterleave", (PyCFunction)Audio_deinterleave, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"decode_pcm8", (PyCFunction)Audio_decode_pcm8, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"encode_pcm8", (PyCFunction)Audio_encode_pcm8, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"decode_adpcm", (PyCFunction)Audio_decode_adpcm, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"encode_adpcm", (PyCFunction)Audio_encode_adpcm, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"encode_adpcm_multi", (PyCFunction)Audio_encode_adpcm_multi, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"encode_adpcm_many", (PyCFunction)Audio_encode_adpcm_many, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"get_adpcm_context", Audio_get_adpcm_context, METH_VARARGS, NULL},
+	{"get_adpcm_seek_table", Audio_get_adpcm_seek_table, METH_VARARGS, NULL},
+	{"decode_adpcm_range", (PyCFunction)Audio_decode_adpcm_range, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"decode_adpcm_blocks", (PyCFunction)Audio_decode_adpcm_blocks, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"decode_ima_adpcm", (PyCFunction)Audio_decode_ima_adpcm, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"encode_ima_adpcm", (PyCFunction)Audio_encode_ima_adpcm, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"decode_ima_adpcm_blocks", (PyCFunction)Audio_decode_ima_adpcm_blocks, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"resample", (PyCFunction)Audio_resample, METH_VARARGS | METH_KEYWORDS, NULL},
+	NULL
+};
+
+PyModuleDef AudioModule = {
+	PyModuleDef_HEAD_INIT,
+	"audio",
+	"Audio conversion",
+	-1,
+	
+	AudioMethods
 };
 
 PyMODINIT_FUNC PyInit_audio() {
-	return PyModule_Create(&AudioModule);
+	PyObject *module = PyModule_Create(&AudioModule);
+	if (!module) return NULL;
+	
+	if (PyModule_AddType(module, &ADPCMDecoderType) < 0) {
+		Py_DECREF(module);
+		return NULL;
+	}
+	if (PyModule_AddType(module, &StreamReaderType) < 0) {
+		Py_DECREF(module);
+		return NULL;
+	}
+	if (PyModule_AddType(module, &IMAADPCMDecoderType) < 0) {
+		Py_DECREF(module);
+		return NULL;
+	}
+	if (PyModule_AddType(module, &IMAADPCMEncoderType) < 0) {
+		Py_DECREF(module);
+		return NULL;
+	}
+	if (PyModule_AddType(module, &ResamplerType) < 0) {
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
 }
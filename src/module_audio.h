@@ -0,0 +1,11 @@
+
+#pragma once
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstdint>
+
+bool parse_coef_list(PyObject *list, int16_t *coefs);
+PyObject *build_coef_list(const int16_t *coefs);
+bool check_ima_index(long index);
+bool check_resample_args(uint32_t in_rate, uint32_t out_rate, uint32_t channels);
@@ -67,6 +67,62 @@ EndianError swap_array(
 	return EndianError::InvalidSize;
 }
 
+template <typename T>
+void extract_tmpl(
+	const uint8_t *in, size_t records, uint8_t *out,
+	size_t offset, size_t count, size_t stride
+) {
+	T *dst = (T *)out;
+	if (stride == count * sizeof(T)) {
+		const T *src = (const T *)in;
+		for (size_t i = 0; i < records * count; i++) {
+			dst[i] = swap_value<T>(src[i]);
+		}
+		return;
+	}
+	
+	for (size_t rec = 0; rec < records; rec++) {
+		const T *src = (const T *)&in[rec * stride + offset];
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = swap_value<T>(src[i]);
+		}
+		dst += count;
+	}
+}
+
+/* The parameters must have been validated with check_extract */
+void extract(
+	const uint8_t *in, size_t insize, uint8_t *out, size_t size,
+	size_t offset, size_t count, size_t stride
+) {
+	size_t records = insize / stride;
+	if (size == 1) {
+		for (size_t rec = 0; rec < records; rec++) {
+			memcpy(out, &in[rec * stride + offset], count);
+			out += count;
+		}
+	}
+	else if (size == 2) {
+		extract_tmpl<uint16_t>(in, records, out, offset, count, stride);
+	}
+	else if (size == 4) {
+		extract_tmpl<uint32_t>(in, records, out, offset, count, stride);
+	}
+}
+
+EndianError check_extract(size_t insize, size_t size, size_t offset, size_t count, size_t stride) {
+	if (size != 1 && size != 2 && size != 4) {
+		return EndianError::InvalidSize;
+	}
+	if (stride == 0 || offset > stride || (stride - offset) / size < count) {
+		return EndianError::InvalidParameters;
+	}
+	if (insize % stride) {
+		return EndianError::SizeNotAligned;
+	}
+	return EndianError::OK;
+}
+
 
 void Endian_set_error(EndianError error) {
 	if (error == EndianError::InvalidSize) {
@@ -125,8 +181,47 @@ PyObject *Endian_swap_array(PyObject *self, PyObject *args) {
 	return bytes;
 }
 
+PyObject *Endian_extract(PyObject *self, PyObject *args) {
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t size;
+	uint32_t offset;
+	uint32_t count = 1;
+	uint32_t stride;
+	
+	size_t nargs = PyTuple_Size(args);
+	if (nargs == 4) {
+		if (!PyArg_ParseTuple(args, "y#III", &in, &inlen, &size, &offset, &stride)) {
+			return NULL;
+		}
+	}
+	else if (nargs == 5) {
+		if (!PyArg_ParseTuple(args, "y#IIII", &in, &inlen, &size, &offset, &count, &stride)) {
+			return NULL;
+		}
+	}
+	else {
+		PyErr_SetString(PyExc_TypeError, "endian.extract takes 4 or 5 arguments");
+		return NULL;
+	}
+	
+	EndianError error = check_extract(inlen, size, offset, count, stride);
+	if (error != EndianError::OK) {
+		Endian_set_error(error);
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, inlen / stride * count * size);
+	if (!bytes) return NULL;
+	
+	uint8_t *out = (uint8_t *)PyBytes_AsString(bytes);
+	extract(in, inlen, out, size, offset, count, stride);
+	return bytes;
+}
+
 PyMethodDef EndianMethods[] = {
 	{"swap_array", Endian_swap_array, METH_VARARGS, NULL},
+	{"extract", Endian_extract, METH_VARARGS, NULL},
 	NULL
 };
 
@@ -3,10 +3,12 @@
 
 #include "type_surface.h"
 
+#include "gx2/attribute.h"
 #include "gx2/facade.h"
 #include "gx2/surface.h"
 #include "gx2/codecs.h"
 #include "gx2/enum.h"
+#include "gx2/swizzle_cache.h"
 
 #include <Python.h>
 #include <cstdint>
@@ -41,7 +43,13 @@ PyObject *convert_tilemode(
 	}
 	
 	GX2Surface output;
-	if (!gx2::convert_tilemode(&surface, &output, tilemode_out, swizzle_out)) {
+	bool success;
+	
+	Py_BEGIN_ALLOW_THREADS
+	success = gx2::convert_tilemode(&surface, &output, tilemode_out, swizzle_out);
+	Py_END_ALLOW_THREADS
+	
+	if (!success) {
 		return PyErr_NoMemory();
 	}
 	
@@ -100,7 +108,12 @@ PyObject *GX2_decode(PyObject *self, PyObject *args) {
 	uint32_t width;
 	uint32_t height;
 	GX2SurfaceFormat format;
-	if (!PyArg_ParseTuple(args, "y#III", &in, &inlen, &width, &height, &format)) {
+	GX2TileMode tilemode = GX2_TILE_MODE_LINEAR_SPECIAL;
+	uint8_t swizzle = 0;
+	if (!PyArg_ParseTuple(
+	  args, "y#III|Ib", &in, &inlen, &width, &height,
+	  &format, &tilemode, &swizzle
+	)) {
 		return NULL;
 	}
 	if (!gx2::is_format_supported(format)) {
@@ -117,8 +130,8 @@ PyObject *GX2_decode(PyObject *self, PyObject *args) {
 	surface.format = format;
 	surface.aa = GX2_AA_MODE_1X;
 	surface.use = GX2_SURFACE_USE_TEXTURE;
-	surface.tile_mode = GX2_TILE_MODE_LINEAR_SPECIAL;
-	surface.swizzle = 0;
+	surface.tile_mode = tilemode;
+	surface.swizzle = swizzle << 8;
 	
 	GX2CalcSurfaceSizeAndAlignment(&surface);
 	
@@ -133,7 +146,13 @@ PyObject *GX2_decode(PyObject *self, PyObject *args) {
 	}
 	
 	GX2Surface output;
-	if (!gx2::decode(&surface, &output)) {
+	bool success;
+	
+	Py_BEGIN_ALLOW_THREADS
+	success = gx2::decode(&surface, &output);
+	Py_END_ALLOW_THREADS
+	
+	if (!success) {
 		return PyErr_NoMemory();
 	}
 	
@@ -142,10 +161,79 @@ PyObject *GX2_decode(PyObject *self, PyObject *args) {
 	return bytes;
 }
 
+PyObject *GX2_decode_attribute(PyObject *self, PyObject *args) {
+	const uint8_t *in;
+	size_t inlen;
+	GX2AttribFormat format;
+	uint32_t offset;
+	uint32_t stride;
+	uint32_t count;
+	if (!PyArg_ParseTuple(args, "y#IIII", &in, &inlen, &format, &offset, &stride, &count)) {
+		return NULL;
+	}
+	if (!gx2::is_attrib_format_supported(format)) {
+		PyErr_SetString(PyExc_ValueError, "attribute format not supported");
+		return NULL;
+	}
+	
+	uint32_t components = gx2::attrib_format_components(format);
+	if (count) {
+		uint64_t end = offset + (uint64_t)stride * (count - 1) + gx2::attrib_format_size(format);
+		if (end > inlen) {
+			PyErr_SetString(PyExc_ValueError, "vertex buffer is too small for specified attribute");
+			return NULL;
+		}
+	}
+	
+	if ((uint64_t)count * components > 0x10000000) {
+		PyErr_SetString(PyExc_OverflowError, "too many vertices");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, (size_t)count * components * sizeof(float));
+	if (!bytes) return NULL;
+	
+	float *out = (float *)PyBytes_AsString(bytes);
+	gx2::decode_attribute(out, in + offset, stride, count, format);
+	return bytes;
+}
+
+PyObject *GX2_get_swizzle_cache_stats(PyObject *self, PyObject *args) {
+	gx2::SwizzleCacheStats stats;
+	gx2::get_swizzle_cache_stats(&stats);
+	return Py_BuildValue(
+		"KKnnn", (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+		(Py_ssize_t)stats.entries, (Py_ssize_t)stats.size, (Py_ssize_t)stats.capacity
+	);
+}
+
+PyObject *GX2_set_swizzle_cache_size(PyObject *self, PyObject *args) {
+	Py_ssize_t size;
+	if (!PyArg_ParseTuple(args, "n", &size)) {
+		return NULL;
+	}
+	if (size < 0) {
+		PyErr_SetString(PyExc_ValueError, "cache size must not be negative");
+		return NULL;
+	}
+	
+	gx2::set_swizzle_cache_capacity(size);
+	Py_RETURN_NONE;
+}
+
+PyObject *GX2_clear_swizzle_cache(PyObject *self, PyObject *args) {
+	gx2::clear_swizzle_cache();
+	Py_RETURN_NONE;
+}
+
 PyMethodDef GX2Methods[] = {
 	{"swizzle", GX2_swizzle, METH_VARARGS, NULL},
 	{"deswizzle", GX2_deswizzle, METH_VARARGS, NULL},
 	{"decode", GX2_decode, METH_VARARGS, NULL},
+	{"decode_attribute", GX2_decode_attribute, METH_VARARGS, NULL},
+	{"get_swizzle_cache_stats", GX2_get_swizzle_cache_stats, METH_NOARGS, NULL},
+	{"set_swizzle_cache_size", GX2_set_swizzle_cache_size, METH_VARARGS, NULL},
+	{"clear_swizzle_cache", GX2_clear_swizzle_cache, METH_NOARGS, NULL},
 	NULL
 };
 
@@ -173,6 +261,17 @@ PyMODINIT_FUNC PyInit_gx2() {
 		return NULL;
 	}
 	
+	PyObject *attrib_formats = PyList_New(gx2::num_supported_attrib_formats);
+	for (size_t i = 0; i < gx2::num_supported_attrib_formats; i++) {
+		PyList_SetItem(attrib_formats, i, PyLong_FromLong(gx2::supported_attrib_formats[i]));
+	}
+	
+	if (PyModule_AddObject(module, "SUPPORTED_ATTRIBUTE_FORMATS", attrib_formats) < 0) {
+		Py_DECREF(attrib_formats);
+		Py_DECREF(module);
+		return NULL;
+	}
+	
 	PyModule_AddType(module, &SurfaceType);
 	
 	return module;
@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/* The number of threads that parallel_for may use when it is called on the
+ * current thread, or 0 if every core may be used. The workers of parallel_for
+ * split the threads of their caller, so nested calls only run in parallel if
+ * there are fewer items than threads. */
+inline size_t &thread_budget() {
+	thread_local size_t value = 0;
+	return value;
+}
+
+inline size_t default_thread_count() {
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+inline size_t available_thread_count() {
+	return thread_budget() ? thread_budget() : default_thread_count();
+}
+
+/* Returns the number of threads that should share the given amount of work.
+ * Every thread gets at least min_work, because starting a thread costs more
+ * than processing a small input. */
+inline size_t get_thread_count(size_t work, size_t min_work) {
+	return std::max<size_t>(std::min(available_thread_count(), work / min_work), 1);
+}
+
+/* Calls func(i) for every i in [0, count) on a pool of worker threads. */
+template <typename F>
+void parallel_for(size_t count, F func, size_t threads = 0) {
+	size_t available = available_thread_count();
+	if (!threads || threads > available) {
+		threads = available;
+	}
+	threads = std::min(threads, count);
+	
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; i++) {
+			func(i);
+		}
+		return;
+	}
+	
+	size_t budget = available / threads;
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		size_t previous = thread_budget();
+		thread_budget() = budget;
+		size_t i;
+		while ((i = next++) < count) {
+			func(i);
+		}
+		thread_budget() = previous;
+	};
+	
+	std::vector<std::thread> pool;
+	for (size_t i = 1; i < threads; i++) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	
+	for (std::thread &thread : pool) {
+		thread.join();
+	}
+}
@@ -0,0 +1,113 @@
+
+#include "type_adpcm_decoder.h"
+#include "module_audio.h"
+
+#include "structmember.h"
+
+int ADPCMDecoder_init(ADPCMDecoderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"coefs", "hist1", "hist2", NULL};
+	
+	PyObject *coefList;
+	int16_t hist1 = 0;
+	int16_t hist2 = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!|hh", (char **)keywords, &PyList_Type, &coefList, &hist1, &hist2)) {
+		return -1;
+	}
+	
+	memset(&self->ctx, 0, sizeof(self->ctx));
+	if (!parse_coef_list(coefList, self->ctx.coefs)) {
+		return -1;
+	}
+	
+	self->ctx.hist1 = hist1;
+	self->ctx.hist2 = hist2;
+	return 0;
+}
+
+void ADPCMDecoder_dealloc(ADPCMDecoderObject *self) {
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *ADPCMDecoder_decode(ADPCMDecoderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "samples", "float32", NULL};
+	
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t samples;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#I|p", (char **)keywords, &in, &inlen, &samples, &float32)) {
+		return NULL;
+	}
+	
+	if (samples > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	if (audio::get_adpcm_size(samples) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	/* The state is only updated if the whole chunk was decoded */
+	audio::ADPCMContext ctx = self->ctx;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	bool result;
+	if (float32) {
+		result = audio::decode_adpcm((float *)out, in, samples, &ctx);
+	}
+	else {
+		result = audio::decode_adpcm((int16_t *)out, in, samples, &ctx);
+	}
+	
+	if (!result) {
+		Py_DECREF(bytes);
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+		return NULL;
+	}
+	
+	self->ctx = ctx;
+	return bytes;
+}
+
+PyObject *ADPCMDecoder_get_coefs(ADPCMDecoderObject *self, void *closure) {
+	return build_coef_list(self->ctx.coefs);
+}
+
+PyMemberDef ADPCMDecoder_members[] = {
+	{"header", T_UBYTE, offsetof(ADPCMDecoderObject, ctx.header), READONLY},
+	{"hist1", T_SHORT, offsetof(ADPCMDecoderObject, ctx.hist1)},
+	{"hist2", T_SHORT, offsetof(ADPCMDecoderObject, ctx.hist2)},
+	{NULL}
+};
+
+PyGetSetDef ADPCMDecoder_getset[] = {
+	{"coefs", (getter)ADPCMDecoder_get_coefs, NULL},
+	{NULL}
+};
+
+PyMethodDef ADPCMDecoder_methods[] = {
+	{"decode", (PyCFunction)ADPCMDecoder_decode, METH_VARARGS | METH_KEYWORDS},
+	{NULL}
+};
+
+PyTypeObject ADPCMDecoderType = []() -> PyTypeObject {
+	PyTypeObject type = {PyVarObject_HEAD_INIT(NULL, 0)};
+	type.tp_name = "ADPCMDecoder";
+	type.tp_doc = "A stateful DSP-ADPCM decoder";
+	type.tp_basicsize = sizeof(ADPCMDecoderObject);
+	type.tp_flags = Py_TPFLAGS_DEFAULT;
+	type.tp_dealloc = (destructor)ADPCMDecoder_dealloc;
+	type.tp_new = PyType_GenericNew;
+	type.tp_init = (initproc)ADPCMDecoder_init;
+	type.tp_members = ADPCMDecoder_members;
+	type.tp_getset = ADPCMDecoder_getset;
+	type.tp_methods = ADPCMDecoder_methods;
+	return type;
+}();
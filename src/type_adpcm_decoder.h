@@ -0,0 +1,11 @@
+
+#define PY_SSIZE_T_CLEAN
+#include "audio/adpcm.h"
+#include <Python.h>
+
+struct ADPCMDecoderObject {
+	PyObject_HEAD
+	audio::ADPCMContext ctx;
+};
+
+extern PyTypeObject ADPCMDecoderType;
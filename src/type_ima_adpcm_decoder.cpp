@@ -0,0 +1,115 @@
+
+#include "type_ima_adpcm_decoder.h"
+#include "module_audio.h"
+
+#include "structmember.h"
+
+int IMAADPCMDecoder_init(IMAADPCMDecoderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"predictor", "index", NULL};
+	
+	int16_t predictor = 0;
+	int index = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|hi", (char **)keywords, &predictor, &index)) {
+		return -1;
+	}
+	
+	if (!check_ima_index(index)) {
+		return -1;
+	}
+	
+	self->ctx.predictor = predictor;
+	self->ctx.index = index;
+	return 0;
+}
+
+void IMAADPCMDecoder_dealloc(IMAADPCMDecoderObject *self) {
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *IMAADPCMDecoder_decode(IMAADPCMDecoderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "samples", "float32", NULL};
+	
+	const uint8_t *in;
+	size_t inlen;
+	uint32_t samples;
+	int float32 = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#I|p", (char **)keywords, &in, &inlen, &samples, &float32)) {
+		return NULL;
+	}
+	
+	if (samples > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	if (audio::get_ima_adpcm_size(samples) > inlen) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, samples * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	if (float32) {
+		audio::decode_ima_adpcm((float *)out, in, samples, &self->ctx);
+	}
+	else {
+		audio::decode_ima_adpcm((int16_t *)out, in, samples, &self->ctx);
+	}
+	return bytes;
+}
+
+PyObject *IMAADPCMDecoder_get_index(IMAADPCMDecoderObject *self, void *closure) {
+	return PyLong_FromLong(self->ctx.index);
+}
+
+int IMAADPCMDecoder_set_index(IMAADPCMDecoderObject *self, PyObject *value, void *closure) {
+	if (!value) {
+		PyErr_SetString(PyExc_TypeError, "cannot delete index");
+		return -1;
+	}
+	
+	long index = PyLong_AsLong(value);
+	if (index == -1 && PyErr_Occurred()) {
+		return -1;
+	}
+	
+	if (!check_ima_index(index)) {
+		return -1;
+	}
+	
+	self->ctx.index = index;
+	return 0;
+}
+
+PyMemberDef IMAADPCMDecoder_members[] = {
+	{"predictor", T_SHORT, offsetof(IMAADPCMDecoderObject, ctx.predictor)},
+	{NULL}
+};
+
+PyGetSetDef IMAADPCMDecoder_getset[] = {
+	{"index", (getter)IMAADPCMDecoder_get_index, (setter)IMAADPCMDecoder_set_index},
+	{NULL}
+};
+
+PyMethodDef IMAADPCMDecoder_methods[] = {
+	{"decode", (PyCFunction)IMAADPCMDecoder_decode, METH_VARARGS | METH_KEYWORDS},
+	{NULL}
+};
+
+PyTypeObject IMAADPCMDecoderType = []() -> PyTypeObject {
+	PyTypeObject type = {PyVarObject_HEAD_INIT(NULL, 0)};
+	type.tp_name = "IMAADPCMDecoder";
+	type.tp_doc = "A stateful IMA-ADPCM decoder";
+	type.tp_basicsize = sizeof(IMAADPCMDecoderObject);
+	type.tp_flags = Py_TPFLAGS_DEFAULT;
+	type.tp_dealloc = (destructor)IMAADPCMDecoder_dealloc;
+	type.tp_new = PyType_GenericNew;
+	type.tp_init = (initproc)IMAADPCMDecoder_init;
+	type.tp_members = IMAADPCMDecoder_members;
+	type.tp_getset = IMAADPCMDecoder_getset;
+	type.tp_methods = IMAADPCMDecoder_methods;
+	return type;
+}();
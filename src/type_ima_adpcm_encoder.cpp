@@ -0,0 +1,109 @@
+
+#include "type_ima_adpcm_encoder.h"
+#include "module_audio.h"
+
+#include "structmember.h"
+
+int IMAADPCMEncoder_init(IMAADPCMEncoderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"predictor", "index", NULL};
+	
+	int16_t predictor = 0;
+	int index = 0;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|hi", (char **)keywords, &predictor, &index)) {
+		return -1;
+	}
+	
+	if (!check_ima_index(index)) {
+		return -1;
+	}
+	
+	self->ctx.predictor = predictor;
+	self->ctx.index = index;
+	return 0;
+}
+
+void IMAADPCMEncoder_dealloc(IMAADPCMEncoderObject *self) {
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *IMAADPCMEncoder_encode(IMAADPCMEncoderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "big_endian", NULL};
+	
+	const int16_t *in;
+	size_t inlen;
+	int big_endian = false;
+	
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#|p", (char **)keywords, &in, &inlen, &big_endian)) {
+		return NULL;
+	}
+	
+	if (inlen % 2) {
+		PyErr_SetString(PyExc_ValueError, "buffer must contain an even number of bytes");
+		return NULL;
+	}
+	
+	if (inlen / 2 > 0x4000000) {
+		PyErr_SetString(PyExc_OverflowError, "stream is too large");
+		return NULL;
+	}
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, audio::get_ima_adpcm_size(inlen / 2));
+	if (!bytes) return NULL;
+	
+	uint8_t *out = (uint8_t *)PyBytes_AS_STRING(bytes);
+	audio::encode_ima_adpcm(out, in, inlen / 2, &self->ctx, big_endian);
+	return bytes;
+}
+
+PyObject *IMAADPCMEncoder_get_index(IMAADPCMEncoderObject *self, void *closure) {
+	return PyLong_FromLong(self->ctx.index);
+}
+
+int IMAADPCMEncoder_set_index(IMAADPCMEncoderObject *self, PyObject *value, void *closure) {
+	if (!value) {
+		PyErr_SetString(PyExc_TypeError, "cannot delete index");
+		return -1;
+	}
+	
+	long index = PyLong_AsLong(value);
+	if (index == -1 && PyErr_Occurred()) {
+		return -1;
+	}
+	
+	if (!check_ima_index(index)) {
+		return -1;
+	}
+	
+	self->ctx.index = index;
+	return 0;
+}
+
+PyMemberDef IMAADPCMEncoder_members[] = {
+	{"predictor", T_SHORT, offsetof(IMAADPCMEncoderObject, ctx.predictor)},
+	{NULL}
+};
+
+PyGetSetDef IMAADPCMEncoder_getset[] = {
+	{"index", (getter)IMAADPCMEncoder_get_index, (setter)IMAADPCMEncoder_set_index},
+	{NULL}
+};
+
+PyMethodDef IMAADPCMEncoder_methods[] = {
+	{"encode", (PyCFunction)IMAADPCMEncoder_encode, METH_VARARGS | METH_KEYWORDS},
+	{NULL}
+};
+
+PyTypeObject IMAADPCMEncoderType = []() -> PyTypeObject {
+	PyTypeObject type = {PyVarObject_HEAD_INIT(NULL, 0)};
+	type.tp_name = "IMAADPCMEncoder";
+	type.tp_doc = "A stateful IMA-ADPCM encoder";
+	type.tp_basicsize = sizeof(IMAADPCMEncoderObject);
+	type.tp_flags = Py_TPFLAGS_DEFAULT;
+	type.tp_dealloc = (destructor)IMAADPCMEncoder_dealloc;
+	type.tp_new = PyType_GenericNew;
+	type.tp_init = (initproc)IMAADPCMEncoder_init;
+	type.tp_members = IMAADPCMEncoder_members;
+	type.tp_getset = IMAADPCMEncoder_getset;
+	type.tp_methods = IMAADPCMEncoder_methods;
+	return type;
+}();
@@ -0,0 +1,11 @@
+
+#define PY_SSIZE_T_CLEAN
+#include "audio/ima_adpcm.h"
+#include <Python.h>
+
+struct IMAADPCMEncoderObject {
+	PyObject_HEAD
+	audio::IMAADPCMContext ctx;
+};
+
+extern PyTypeObject IMAADPCMEncoderType;
@@ -0,0 +1,150 @@
+
+#include "type_resampler.h"
+#include "module_audio.h"
+
+#include "structmember.h"
+
+/* The resampler is used without the GIL, so other threads must not touch it
+ * in the meantime */
+static bool Resampler_check_busy(ResamplerObject *self) {
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "resampler is already in use");
+		return false;
+	}
+	return true;
+}
+
+int Resampler_init(ResamplerObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"in_rate", "out_rate", "channels", NULL};
+	
+	uint32_t in_rate;
+	uint32_t out_rate;
+	uint32_t channels = 1;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "II|I", (char **)keywords, &in_rate, &out_rate, &channels)) {
+		return -1;
+	}
+	
+	if (!check_resample_args(in_rate, out_rate, channels)) {
+		return -1;
+	}
+	
+	if (!Resampler_check_busy(self)) {
+		return -1;
+	}
+	
+	audio::free_resampler(&self->resampler);
+	if (!audio::init_resampler(&self->resampler, in_rate, out_rate, channels)) {
+		PyErr_NoMemory();
+		return -1;
+	}
+	return 0;
+}
+
+void Resampler_dealloc(ResamplerObject *self) {
+	audio::free_resampler(&self->resampler);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+bool Resampler_check(ResamplerObject *self) {
+	if (!self->resampler.filter) {
+		PyErr_SetString(PyExc_ValueError, "resampler is not initialized");
+		return false;
+	}
+	return Resampler_check_busy(self);
+}
+
+PyObject *Resampler_process(ResamplerObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"data", "float32", NULL};
+	
+	const int16_t *in;
+	size_t inlen;
+	int float32 = false;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y#|p", (char **)keywords, &in, &inlen, &float32)) {
+		return NULL;
+	}
+	
+	if (!Resampler_check(self)) {
+		return NULL;
+	}
+	
+	audio::Resampler *resampler = &self->resampler;
+	if (inlen % (resampler->channels * 2)) {
+		PyErr_SetString(PyExc_ValueError, "number of samples must be divisible by number of channels");
+		return NULL;
+	}
+	
+	size_t frames = inlen / 2 / resampler->channels;
+	size_t count = audio::get_resample_count(resampler, frames);
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, count * resampler->channels * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	self->busy = true;
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		audio::resample(resampler, (float *)out, in, frames);
+	}
+	else {
+		audio::resample(resampler, (int16_t *)out, in, frames);
+	}
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+	
+	return bytes;
+}
+
+PyObject *Resampler_flush(ResamplerObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"float32", NULL};
+	
+	int float32 = false;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", (char **)keywords, &float32)) {
+		return NULL;
+	}
+	
+	if (!Resampler_check(self)) {
+		return NULL;
+	}
+	
+	audio::Resampler *resampler = &self->resampler;
+	size_t count = audio::get_flush_count(resampler);
+	
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, count * resampler->channels * (float32 ? 4 : 2));
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	if (float32) {
+		audio::flush_resampler(resampler, (float *)out);
+	}
+	else {
+		audio::flush_resampler(resampler, (int16_t *)out);
+	}
+	return bytes;
+}
+
+PyMemberDef Resampler_members[] = {
+	{"channels", T_UINT, offsetof(ResamplerObject, resampler.channels), READONLY},
+	{"taps", T_UINT, offsetof(ResamplerObject, resampler.taps), READONLY},
+	{NULL}
+};
+
+PyMethodDef Resampler_methods[] = {
+	{"process", (PyCFunction)Resampler_process, METH_VARARGS | METH_KEYWORDS},
+	{"flush", (PyCFunction)Resampler_flush, METH_VARARGS | METH_KEYWORDS},
+	{NULL}
+};
+
+PyTypeObject ResamplerType = []() -> PyTypeObject {
+	PyTypeObject type = {PyVarObject_HEAD_INIT(NULL, 0)};
+	type.tp_name = "Resampler";
+	type.tp_doc = "A streaming polyphase sample rate converter";
+	type.tp_basicsize = sizeof(ResamplerObject);
+	type.tp_flags = Py_TPFLAGS_DEFAULT;
+	type.tp_dealloc = (destructor)Resampler_dealloc;
+	type.tp_new = PyType_GenericNew;
+	type.tp_init = (initproc)Resampler_init;
+	type.tp_members = Resampler_members;
+	type.tp_methods = Resampler_methods;
+	return type;
+}();
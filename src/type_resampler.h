@@ -0,0 +1,12 @@
+
+#define PY_SSIZE_T_CLEAN
+#include "audio/resample.h"
+#include <Python.h>
+
+struct ResamplerObject {
+	PyObject_HEAD
+	audio::Resampler resampler;
+	bool busy;
+};
+
+extern PyTypeObject ResamplerType;
@@ -0,0 +1,183 @@
+
+#include "type_stream_reader.h"
+#include "module_audio.h"
+
+#include "structmember.h"
+
+void StreamReader_set_error(audio::StreamError error) {
+	if (error == audio::StreamError::InvalidFile) {
+		PyErr_SetString(PyExc_ValueError, "invalid stream file");
+	}
+	else if (error == audio::StreamError::UnsupportedCodec) {
+		PyErr_SetString(PyExc_NotImplementedError, "unsupported codec");
+	}
+	else if (error == audio::StreamError::OutOfRange) {
+		PyErr_SetString(PyExc_IndexError, "sample range is out of bounds");
+	}
+	else if (error == audio::StreamError::InvalidCoefs) {
+		PyErr_SetString(PyExc_OverflowError, "buffer overflow (coefs)");
+	}
+	else if (error == audio::StreamError::NoMemory) {
+		PyErr_NoMemory();
+	}
+}
+
+/* The stream is read without the GIL, so other threads must not release it
+ * in the meantime */
+static bool StreamReader_check_busy(StreamReaderObject *self) {
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "stream reader is already in use");
+		return false;
+	}
+	return true;
+}
+
+void StreamReader_release(StreamReaderObject *self) {
+	audio::free_stream(&self->info);
+	if (self->buffer.obj) {
+		PyBuffer_Release(&self->buffer);
+	}
+}
+
+int StreamReader_init(StreamReaderObject *self, PyObject *args) {
+	Py_buffer buffer;
+	if (!PyArg_ParseTuple(args, "y*", &buffer)) {
+		return -1;
+	}
+	
+	if (!StreamReader_check_busy(self)) {
+		PyBuffer_Release(&buffer);
+		return -1;
+	}
+	
+	StreamReader_release(self);
+	
+	/* The buffer is kept until the reader is destroyed, so mmap objects are never copied */
+	self->buffer = buffer;
+	
+	audio::StreamError error = audio::parse_stream(&self->info, (const uint8_t *)buffer.buf, buffer.len);
+	if (error != audio::StreamError::OK) {
+		StreamReader_release(self);
+		StreamReader_set_error(error);
+		return -1;
+	}
+	return 0;
+}
+
+void StreamReader_dealloc(StreamReaderObject *self) {
+	StreamReader_release(self);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+PyObject *StreamReader_read(StreamReaderObject *self, PyObject *args, PyObject *kwargs) {
+	static const char *keywords[] = {"start", "count", "float32", NULL};
+	
+	uint32_t start;
+	uint32_t count;
+	int float32 = false;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "II|p", (char **)keywords, &start, &count, &float32)) {
+		return NULL;
+	}
+	
+	if (!self->buffer.obj) {
+		PyErr_SetString(PyExc_ValueError, "stream reader is not initialized");
+		return NULL;
+	}
+	
+	if (!StreamReader_check_busy(self)) {
+		return NULL;
+	}
+	
+	audio::StreamInfo *info = &self->info;
+	if (start > info->samples || count > info->samples - start) {
+		StreamReader_set_error(audio::StreamError::OutOfRange);
+		return NULL;
+	}
+	
+	size_t sampleSize = float32 ? 4 : 2;
+	PyObject *bytes = PyBytes_FromStringAndSize(NULL, (Py_ssize_t)count * info->channels * sampleSize);
+	if (!bytes) return NULL;
+	
+	char *out = PyBytes_AS_STRING(bytes);
+	
+	audio::StreamError error;
+	self->busy = true;
+	Py_BEGIN_ALLOW_THREADS
+	if (float32) {
+		error = audio::read_stream((float *)out, info, start, count);
+	}
+	else {
+		error = audio::read_stream((int16_t *)out, info, start, count);
+	}
+	Py_END_ALLOW_THREADS
+	self->busy = false;
+	
+	if (error != audio::StreamError::OK) {
+		Py_DECREF(bytes);
+		StreamReader_set_error(error);
+		return NULL;
+	}
+	return bytes;
+}
+
+PyObject *StreamReader_get_codec(StreamReaderObject *self, void *closure) {
+	return PyLong_FromLong((long)self->info.codec);
+}
+
+PyObject *StreamReader_get_coefs(StreamReaderObject *self, void *closure) {
+	if (!self->info.contexts) {
+		Py_RETURN_NONE;
+	}
+	
+	PyObject *list = PyList_New(self->info.channels);
+	if (!list) return NULL;
+	
+	for (uint32_t i = 0; i < self->info.channels; i++) {
+		PyObject *coefs = build_coef_list(self->info.contexts[i].coefs);
+		if (!coefs) {
+			Py_DECREF(list);
+			return NULL;
+		}
+		PyList_SET_ITEM(list, i, coefs);
+	}
+	return list;
+}
+
+PyMemberDef StreamReader_members[] = {
+	{"big_endian", T_BOOL, offsetof(StreamReaderObject, info.bigEndian), READONLY},
+	{"loop", T_BOOL, offsetof(StreamReaderObject, info.loop), READONLY},
+	{"channels", T_UINT, offsetof(StreamReaderObject, info.channels), READONLY},
+	{"sample_rate", T_UINT, offsetof(StreamReaderObject, info.sampleRate), READONLY},
+	{"loop_start", T_UINT, offsetof(StreamReaderObject, info.loopStart), READONLY},
+	{"samples", T_UINT, offsetof(StreamReaderObject, info.samples), READONLY},
+	{"block_size", T_UINT, offsetof(StreamReaderObject, info.blockSize), READONLY},
+	{"block_samples", T_UINT, offsetof(StreamReaderObject, info.blockSamples), READONLY},
+	{"seek_interval", T_UINT, offsetof(StreamReaderObject, info.seekInterval), READONLY},
+	{NULL}
+};
+
+PyGetSetDef StreamReader_getset[] = {
+	{"codec", (getter)StreamReader_get_codec, NULL},
+	{"coefs", (getter)StreamReader_get_coefs, NULL},
+	{NULL}
+};
+
+PyMethodDef StreamReader_methods[] = {
+	{"read", (PyCFunction)StreamReader_read, METH_VARARGS | METH_KEYWORDS},
+	{NULL}
+};
+
+PyTypeObject StreamReaderType = []() -> PyTypeObject {
+	PyTypeObject type = {PyVarObject_HEAD_INIT(NULL, 0)};
+	type.tp_name = "StreamReader";
+	type.tp_doc = "Reads samples from a BFSTM, BCSTM or BRSTM file";
+	type.tp_basicsize = sizeof(StreamReaderObject);
+	type.tp_flags = Py_TPFLAGS_DEFAULT;
+	type.tp_dealloc = (destructor)StreamReader_dealloc;
+	type.tp_new = PyType_GenericNew;
+	type.tp_init = (initproc)StreamReader_init;
+	type.tp_members = StreamReader_members;
+	type.tp_getset = StreamReader_getset;
+	type.tp_methods = StreamReader_methods;
+	return type;
+}();
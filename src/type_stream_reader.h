@@ -0,0 +1,13 @@
+
+#define PY_SSIZE_T_CLEAN
+#include "audio/stream.h"
+#include <Python.h>
+
+struct StreamReaderObject {
+	PyObject_HEAD
+	Py_buffer buffer;
+	audio::StreamInfo info;
+	bool busy;
+};
+
+extern PyTypeObject StreamReaderType;
@@ -40,15 +40,16 @@ bool prepare_surface(SurfaceObject *self) {
 bool update_surface(SurfaceObject *self, GX2Surface *surface) {
 	self->surface = *surface;
 	
-	self->image = PyBytes_FromStringAndSize((char *)surface->image, surface->image_size);
+	/* The mipmaps are stored in the same buffer as the image */
+	Py_XSETREF(self->image, PyBytes_FromStringAndSize((char *)surface->image, surface->image_size));
+	Py_XSETREF(self->mipmaps, PyBytes_FromStringAndSize((char *)surface->mipmaps, surface->mipmap_size));
 	free(surface->image);
 	
-	if (!self->image) return false;
+	if (!self->image || !self->mipmaps) return false;
 	
-	self->mipmaps = PyBytes_FromStringAndSize((char *)surface->mipmaps, surface->mipmap_size);
-	if (!self->mipmaps) return false;
+	Py_XSETREF(self->mip_level_offset, PyList_New(13));
+	if (!self->mip_level_offset) return false;
 	
-	self->mip_level_offset = PyList_New(13);
 	for (size_t i = 0; i < 13; i++) {
 		PyObject *value = PyLong_FromLong(surface->mip_level_offset[i]);
 		if (!value) {
@@ -104,6 +105,26 @@ void Surface_dealloc(SurfaceObject *self) {
 	Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
+/* Runs func on a copy of the surface with the GIL released. References to
+ * the buffers are held in case another thread replaces them meanwhile. */
+template <typename F>
+static bool run_without_gil(SurfaceObject *self, F func) {
+	GX2Surface input = self->surface;
+	PyObject *image = self->image;
+	PyObject *mipmaps = self->mipmaps;
+	Py_XINCREF(image);
+	Py_XINCREF(mipmaps);
+	
+	bool success;
+	Py_BEGIN_ALLOW_THREADS
+	success = func(&input);
+	Py_END_ALLOW_THREADS
+	
+	Py_XDECREF(image);
+	Py_XDECREF(mipmaps);
+	return success;
+}
+
 PyObject *Surface_calc_size_and_alignment(SurfaceObject *self, PyObject *args) {
 	GX2CalcSurfaceSizeAndAlignment(&self->surface);
 	Py_RETURN_NONE;
@@ -114,7 +135,10 @@ PyObject *Surface_deswizzle(SurfaceObject *self, PyObject *args) {
 		if (!prepare_surface(self)) return NULL;
 		
 		GX2Surface output;
-		if (!gx2::convert_tilemode(&self->surface, &output, GX2_TILE_MODE_LINEAR_SPECIAL, 0)) {
+		bool success = run_without_gil(self, [&](GX2Surface *input) {
+			return gx2::convert_tilemode(input, &output, GX2_TILE_MODE_LINEAR_SPECIAL, 0);
+		});
+		if (!success) {
 			return PyErr_NoMemory();
 		}
 		
@@ -127,14 +151,17 @@ PyObject *Surface_swizzle(SurfaceObject *self, PyObject *args) {
 	GX2TileMode tilemode;
 	uint8_t swizzle;
 	
-	if (!PyArg_ParseTuple(args, "Ib", &tilemode, swizzle)) {
+	if (!PyArg_ParseTuple(args, "Ib", &tilemode, &swizzle)) {
 		return NULL;
 	}
 	
 	if (!prepare_surface(self)) return NULL;
 		
 	GX2Surface output;
-	if (!gx2::convert_tilemode(&self->surface, &output, tilemode, swizzle)) {
+	bool success = run_without_gil(self, [&](GX2Surface *input) {
+		return gx2::convert_tilemode(input, &output, tilemode, swizzle);
+	});
+	if (!success) {
 		return PyErr_NoMemory();
 	}
 	
@@ -146,18 +173,16 @@ PyObject *Surface_swizzle(SurfaceObject *self, PyObject *args) {
 PyObject *Surface_decode(SurfaceObject *self, PyObject *args) {
 	if (!prepare_surface(self)) return NULL;
 	
-	if (self->surface.tile_mode != GX2_TILE_MODE_LINEAR_SPECIAL) {
-		PyErr_SetString(PyExc_ValueError, "surface must be deswizzled before conversion");
-		return NULL;
-	}
-	
 	if (!gx2::is_format_supported(self->surface.format)) {
 		PyErr_SetString(PyExc_ValueError, "surface format not supported");
 		return NULL;
 	}
 	
 	GX2Surface output;
-	if (!gx2::decode(&self->surface, &output)) {
+	bool success = run_without_gil(self, [&](GX2Surface *input) {
+		return gx2::decode(input, &output);
+	});
+	if (!success) {
 		return PyErr_NoMemory();
 	}
 	